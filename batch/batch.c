@@ -0,0 +1,522 @@
+/**
+ * batch.c
+ *
+ * tty-snake batch simulator (plays many headless games on every core).
+ *
+ * Games are numbered 0 .. n_games - 1 and handed out with a work-stealing
+ * scheduler: every worker owns a range of game numbers, takes games from the
+ * bottom of its own range, and once it runs dry steals the top half of
+ * another worker's range. A range is packed into a single 64-bit word so
+ * that taking and stealing are each one compare-and-swap. Results are kept
+ * in per-worker accumulators and only merged once every worker has finished,
+ * so workers never share a lock, and a worker's range (written by thieves)
+ * sits on a cache line of its own.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <pthread.h>   // pthread_create()
+#include <stdatomic.h> // atomic_compare_exchange_weak()
+#include <stdio.h>     // printf()
+#include <stdlib.h>    // malloc(), strtoul()
+#include <unistd.h>    // getopt(), sysconf()
+
+#include <game.h>
+#include <sim.h>
+
+// default number of games to play
+#define BATCH_DEFAULT_GAMES     10000
+
+// default tick limit per game (so a policy that never ends a game can't
+// keep a worker busy forever)
+#define BATCH_DEFAULT_MAX_TICKS 1000000
+
+// maximum number of policies games can be assigned (round-robin)
+#define BATCH_MAX_POLICIES      16
+
+// size of a cache line, to keep workers' hot data apart
+#define CACHE_LINE_SIZE         64
+
+// packed range of game numbers [lo, hi) (lo in the low 32 bits)
+#define RANGE_PACK(lo,hi) (((uint64_t) (hi) << 32) | (uint32_t) (lo))
+#define RANGE_LO(r)       ((uint32_t) (r))
+#define RANGE_HI(r)       ((uint32_t) ((r) >> 32))
+
+/**
+ * struct:  batch_acc
+ * ------------------
+ * accumulated results of the games played with one policy.
+ */
+struct batch_acc
+{
+  uint64_t     games;
+  uint64_t     wins;
+  uint64_t     ticks;
+  uint64_t     powerup_ticks;
+  uint64_t     score_sum;
+  uint64_t     length_sum;
+  unsigned int best_score;
+  unsigned int best_length;
+};
+
+/**
+ * struct:  batch_worker
+ * ---------------------
+ * range:     game numbers this worker still has to play (stolen from by
+ *              other workers, so it is kept off the worker's own line)
+ * steals:    number of ranges this worker stole
+ * acc:       results of the games this worker played, per policy
+ */
+struct batch_worker
+{
+  _Atomic uint64_t range;
+
+  pthread_t        thread __attribute__((aligned(CACHE_LINE_SIZE)));
+  unsigned int     id;
+  uint64_t         steals;
+  struct batch_acc acc[SIM_POLICY_COUNT];
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+// global variables (read-only while workers run)
+static struct batch_worker * workers;
+static unsigned int          n_workers;
+static uint64_t              base_seed;
+static uint64_t              max_ticks = BATCH_DEFAULT_MAX_TICKS;
+
+static struct sim_config     configs[BATCH_MAX_POLICIES];
+static unsigned int          n_configs;
+
+// private forward declarations
+static bool range_take(struct batch_worker *, uint32_t *);
+static bool range_steal(struct batch_worker *);
+
+
+/*
+ * scheduling
+ */
+
+/**
+ * function:  range_take
+ * ---------------------
+ * takes the next game from the bottom of a worker's own range.
+ *
+ * worker:  the worker (must be the calling thread's)
+ * game_no: set to the number of the game to play
+ *
+ * returns: false if the worker's range is empty
+ */
+static bool range_take(struct batch_worker * worker, uint32_t * game_no)
+{
+  uint64_t range = atomic_load(&worker->range);
+
+  while (RANGE_LO(range) < RANGE_HI(range))
+  {
+    if (atomic_compare_exchange_weak(&worker->range, &range,
+      RANGE_PACK(RANGE_LO(range) + 1, RANGE_HI(range))))
+    {
+      *game_no = RANGE_LO(range);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * function:  range_steal
+ * ----------------------
+ * moves the top half of another worker's range into a worker's (empty)
+ * range. Victims are tried in order, starting after the thief.
+ *
+ * thief: the worker (must be the calling thread's)
+ *
+ * returns: false if every other worker's range is empty (no games are left
+ *            to hand out, since ranges never grow)
+ */
+static bool range_steal(struct batch_worker * thief)
+{
+  unsigned int i;
+
+  for (i = 1; i < n_workers; i++)
+  {
+    struct batch_worker * victim = &workers[(thief->id + i) % n_workers];
+    uint64_t              range  = atomic_load(&victim->range);
+
+    while (RANGE_LO(range) < RANGE_HI(range))
+    {
+      uint32_t lo   = RANGE_LO(range),
+               hi   = RANGE_HI(range),
+               half = (hi - lo + 1) / 2;
+
+      if (atomic_compare_exchange_weak(&victim->range, &range,
+        RANGE_PACK(lo, hi - half)))
+      {
+        // nobody steals from an empty range, so a plain store is safe
+        atomic_store(&thief->range, RANGE_PACK(hi - half, hi));
+        thief->steals++;
+
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * function:  game_seed
+ * --------------------
+ * derives a game's seed from the base seed, so that every game plays out the
+ * same no matter which worker runs it (the game_no-th splitmix64 output).
+ *
+ * game_no: number of the game
+ *
+ * returns: the game's seed
+ */
+static uint64_t game_seed(uint32_t game_no)
+{
+  uint64_t state = base_seed + game_no * 0x9E3779B97F4A7C15ull;
+
+  return rng_splitmix64(&state);
+}
+
+/**
+ * function:  worker_run
+ * ---------------------
+ * plays games until no worker has any left, all on a single game that is
+ * restarted for each of them (every config shares the board size).
+ *
+ * arg: the worker's struct batch_worker
+ *
+ * returns: NULL (required by pthread_create)
+ */
+static void * worker_run(void * arg)
+{
+  struct batch_worker * worker = arg;
+  struct game_ctx       game;
+  uint32_t              game_no;
+
+  // seeded properly by sim_play, before every game
+  game_srand(&game, 0);
+  game_setup(&game, configs[0].x_bound, configs[0].y_bound,
+    configs[0].x_bound / 2, configs[0].y_bound / 2);
+
+  for (;;)
+  {
+    const struct sim_config * config;
+    struct sim_game_result    result;
+    struct batch_acc        * acc;
+
+    // refill an empty range from another worker's, until none are left
+    if (!range_take(worker, &game_no))
+    {
+      if (range_steal(worker))
+        continue;
+
+      break;
+    }
+
+    config = &configs[game_no % n_configs];
+    acc    = &worker->acc[config->policy];
+
+    sim_play(config, &game, game_seed(game_no), max_ticks, &result);
+
+    acc->games++;
+    acc->wins          += result.won;
+    acc->ticks         += result.ticks;
+    acc->powerup_ticks += result.powerup_ticks;
+    acc->score_sum     += result.score;
+    acc->length_sum    += result.length;
+
+    if (result.score > acc->best_score)
+      acc->best_score = result.score;
+
+    if (result.length > acc->best_length)
+      acc->best_length = result.length;
+  }
+
+  game_unset(&game);
+
+  return NULL;
+}
+
+
+/*
+ * reporting
+ */
+
+/**
+ * function:  acc_merge
+ * --------------------
+ * adds one accumulator's results to another's.
+ */
+static void acc_merge(struct batch_acc * into, const struct batch_acc * from)
+{
+  into->games         += from->games;
+  into->wins          += from->wins;
+  into->ticks         += from->ticks;
+  into->powerup_ticks += from->powerup_ticks;
+  into->score_sum     += from->score_sum;
+  into->length_sum    += from->length_sum;
+
+  if (from->best_score > into->best_score)
+    into->best_score = from->best_score;
+
+  if (from->best_length > into->best_length)
+    into->best_length = from->best_length;
+}
+
+/**
+ * function:  acc_print
+ * --------------------
+ * prints one row of the results table.
+ */
+static void acc_print(const char * name, const struct batch_acc * acc)
+{
+  double games = acc->games ? (double) acc->games : 1.0,
+         ticks = acc->ticks ? (double) acc->ticks : 1.0;
+
+  printf("%-10s %10llu %8llu %10.1f %8u %8.1f %8u %12.1f %9.2f%%\n",
+    name,
+    (unsigned long long) acc->games,
+    (unsigned long long) acc->wins,
+    acc->score_sum / games, acc->best_score,
+    acc->length_sum / games, acc->best_length,
+    acc->ticks / games,
+    100.0 * acc->powerup_ticks / ticks);
+}
+
+
+/**
+ * function:  usage
+ * ----------------
+ * prints the command-line options to stderr.
+ *
+ * prog_name: name the program was run as
+ */
+static void usage(const char * prog_name)
+{
+  fprintf(stderr,
+    "usage: %s [-g games] [-j threads] [-x width] [-y height] [-t ticks]\n"
+    "       %*s [-S seed] [-p policies] [-i keys]\n"
+    "\n"
+    "  -g games     number of games to play (default: %d)\n"
+    "  -j threads   number of worker threads (default: one per core)\n"
+    "  -x width     board width  (default: %d)\n"
+    "  -y height    board height (default: %d)\n"
+    "  -t ticks     tick limit per game, 0 for none (default: %d)\n"
+    "  -S seed      base seed, every game derives its own (default: 1)\n"
+    "  -p policies  comma-separated input policies, assigned to games in\n"
+    "               turn: autopilot, random or script (default: autopilot)\n"
+    "  -i keys      key script for the script policy, one key per tick\n"
+    "               ('%c' presses nothing)\n",
+    prog_name, (int) strlen(prog_name), "", BATCH_DEFAULT_GAMES,
+    SIM_DEFAULT_X_BOUND, SIM_DEFAULT_Y_BOUND, BATCH_DEFAULT_MAX_TICKS,
+    SIM_SCRIPT_NOKEY
+  );
+}
+
+/**
+ * function:  parse_policies
+ * -------------------------
+ * fills configs with one simulation config per listed policy.
+ *
+ * list:  comma-separated policy names (modified)
+ * base:  settings shared by every config
+ *
+ * returns: false if a policy is unknown or too many are listed
+ */
+static bool parse_policies(char * list, const struct sim_config * base)
+{
+  char * name;
+
+  n_configs = 0;
+
+  for (name = strtok(list, ","); name; name = strtok(NULL, ","))
+  {
+    if (BATCH_MAX_POLICIES == n_configs)
+      return false;
+
+    configs[n_configs]        = *base;
+    configs[n_configs].policy = sim_policy_from_string(name);
+
+    if (SIM_POLICY_COUNT == configs[n_configs].policy)
+      return false;
+
+    n_configs++;
+  }
+
+  return n_configs > 0;
+}
+
+/**
+ * function:  main
+ * ---------------
+ * tty-snake batch simulator entry-point.
+ *
+ * returns: 0 on success, else 1.
+ */
+int main(int argc, char **argv)
+{
+  unsigned long    n_games  = BATCH_DEFAULT_GAMES;
+  char           * policies = NULL;
+  struct batch_acc totals[SIM_POLICY_COUNT] = { { 0 } },
+                   total                    = { 0 };
+  uint64_t         steals = 0;
+  nanosecond_t     start_ns, elapsed_ns;
+  unsigned int     i, j, n_started;
+  int              opt;
+
+  struct sim_config base = {
+    .x_bound   = SIM_DEFAULT_X_BOUND,
+    .y_bound   = SIM_DEFAULT_Y_BOUND,
+    .max_ticks = 0,
+    .policy       = SIM_POLICY_AUTOPILOT,
+    .script       = NULL,
+    .turn_max_age = TURN_DEFAULT_MAX_AGE
+  };
+
+  long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+  n_workers = (n_cores > 0) ? n_cores : 1;
+  base_seed = 1;
+
+  while ((opt = getopt(argc, argv, "g:j:x:y:t:S:p:i:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'g':
+        n_games = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'j':
+        n_workers = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'x':
+        base.x_bound = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'y':
+        base.y_bound = strtoul(optarg, NULL, 10);
+        break;
+
+      case 't':
+        max_ticks = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'S':
+        base_seed = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'p':
+        policies = optarg;
+        break;
+
+      case 'i':
+        base.script = optarg;
+        break;
+
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  // game numbers are 32 bits (see GAME_BOUNDS_VALID for the board)
+  if (0 == n_workers || n_games > UINT32_MAX
+    || !GAME_BOUNDS_VALID(base.x_bound, base.y_bound))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (policies)
+  {
+    if (!parse_policies(policies, &base))
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  else
+  {
+    configs[0] = base;
+    n_configs  = 1;
+  }
+
+  workers = aligned_alloc(CACHE_LINE_SIZE,
+    n_workers * sizeof(struct batch_worker));
+
+  if (!workers)
+    return 1;
+
+  // split the games evenly, stealing evens out the rest
+  for (i = 0; i < n_workers; i++)
+  {
+    memset(&workers[i], 0, sizeof(struct batch_worker));
+
+    workers[i].id = i;
+    atomic_init(&workers[i].range, RANGE_PACK(n_games * i / n_workers,
+      n_games * (i + 1) / n_workers));
+  }
+
+  start_ns = get_time_ns();
+
+  // the games of a worker that couldn't be started are stolen by the others
+  for (n_started = 0; n_started < n_workers; n_started++)
+    if (0 != pthread_create(&workers[n_started].thread, NULL, worker_run,
+      &workers[n_started]))
+      break;
+
+  if (0 == n_started)
+  {
+    fprintf(stderr, "%s: couldn't start a worker thread\n", argv[0]);
+    free(workers);
+
+    return 1;
+  }
+
+  for (i = 0; i < n_started; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  elapsed_ns = get_time_ns() - start_ns;
+
+  // merge per-worker results
+  for (i = 0; i < n_workers; i++)
+  {
+    for (j = 0; j < SIM_POLICY_COUNT; j++)
+      acc_merge(&totals[j], &workers[i].acc[j]);
+
+    steals += workers[i].steals;
+  }
+
+  printf("%-10s %10s %8s %10s %8s %8s %8s %12s %10s\n",
+    "policy", "games", "wins", "avg_score", "best", "avg_len", "best",
+    "avg_ticks", "powerup");
+
+  for (j = 0; j < SIM_POLICY_COUNT; j++)
+  {
+    if (0 == totals[j].games)
+      continue;
+
+    acc_print(sim_policy_to_string(j), &totals[j]);
+    acc_merge(&total, &totals[j]);
+  }
+
+  acc_print("total", &total);
+
+  printf("\n");
+  printf("board:      %ux%u\n", base.x_bound, base.y_bound);
+  printf("threads:    %u (%llu steals)\n", n_started,
+    (unsigned long long) steals);
+  printf("elapsed:    %.3f ms\n", (double) elapsed_ns / MILLISECONDS);
+  printf("games/sec:  %.0f\n",
+    elapsed_ns ? (double) total.games * SECONDS / elapsed_ns : 0.0);
+  printf("ticks/sec:  %.0f\n",
+    elapsed_ns ? (double) total.ticks * SECONDS / elapsed_ns : 0.0);
+
+  free(workers);
+
+  return 0;
+}
@@ -0,0 +1,727 @@
+/**
+ * bench.c
+ *
+ * tty-snake microbenchmarks for the game and graphics modules.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <fcntl.h>  // open()
+#include <stdio.h>  // printf()
+#include <stdlib.h> // malloc(), qsort(), setenv(), rand_r()
+#include <unistd.h> // getopt(), dup(), dup2()
+
+#include <frame.h>
+#include <game.h>
+#include <graphics.h>
+
+// default number of timed samples per benchmark case
+#define BENCH_DEFAULT_SAMPLES 100000
+
+// snake_set_velocity() is too fast to time per call, so time batches
+#define BENCH_VELOCITY_BATCH 1000
+
+// same for a single random draw
+#define BENCH_RNG_BATCH      1000
+
+// and for advancing a timer wheel by a tick
+#define BENCH_TIMER_BATCH    1000
+
+// most frames to time per graphics_update() case (full redraws are slow)
+#define BENCH_GRAPHICS_LIMIT 10000
+
+/**
+ * struct:  bench_stats
+ * --------------------
+ * summary of a set of timed samples (all in nanoseconds).
+ */
+struct bench_stats
+{
+  size_t       samples;
+  double       mean_ns;
+  nanosecond_t p50_ns;
+  nanosecond_t p99_ns;
+  nanosecond_t max_ns;
+};
+
+// global variables
+static bool           csv_output = false;
+static size_t         n_samples  = BENCH_DEFAULT_SAMPLES;
+static nanosecond_t * sample_ns;
+
+static struct game_ctx game;      // the game being benchmarked
+static struct frame    frame;     // snapshot of it, for graphics benchmarks
+static struct rng      board_rng; // seeds every board
+
+// board sizes to benchmark game_update() on
+static const unsigned int board_sizes[][2] = {
+  {   80,   24 },
+  {  256,  256 },
+  { 1024, 1024 },
+  { 4096, 4096 }
+};
+
+// snake lengths to benchmark game_update() with (clamped to the board)
+static const unsigned int snake_lengths[] = { 4, 256, 65536, 1048576 };
+
+// board fill ratios to benchmark food_spawn() at
+static const double fill_ratios[] = { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+
+/*
+ * board construction
+ */
+
+/**
+ * function:  cycle_next
+ * ---------------------
+ * steps along a Hamiltonian cycle over the board's interior, so that a snake
+ * following it never collides with itself or the walls. The cycle snakes
+ * through columns 2.. of each row and returns upwards along column 1. Only
+ * an even number of interior rows is used.
+ *
+ * c: current (interior) cell
+ *
+ * returns: the next cell on the cycle
+ */
+static coord_t cycle_next(coord_t c)
+{
+  unsigned int w = game.x_bound - 2,
+               h = (game.y_bound - 2) & ~1u,
+               i = COORD_X(c) - 1,
+               j = COORD_Y(c) - 1;
+
+  // column 0: head back up to the first row
+  if (0 == i)
+  {
+    if (0 == j)
+      i++;
+    else
+      j--;
+  }
+  // even rows: left to right
+  else if (0 == j % 2)
+  {
+    if (i < w - 1)
+      i++;
+    else
+      j++;
+  }
+  // odd rows: right to left, then back to column 0 after the last row
+  else
+  {
+    if (i > 1)
+      i--;
+    else if (j < h - 1)
+      j++;
+    else
+      i--;
+  }
+
+  return COORD_PACK(i + 1, j + 1);
+}
+
+/**
+ * function:  cycle_length
+ * -----------------------
+ * returns: number of cells on the cycle walked by cycle_next() on a board
+ *            of the given size
+ */
+static unsigned int cycle_length(unsigned int x_bound, unsigned int y_bound)
+{
+  return (x_bound - 2) * ((y_bound - 2) & ~1u);
+}
+
+/**
+ * function:  board_setup
+ * ----------------------
+ * sets up a game with a snake of the given length laid out along the cycle,
+ * and starts it moving along the cycle.
+ *
+ * x_bound: board width
+ * y_bound: board height
+ * length:  snake length (clamped to the cycle length)
+ *
+ * returns: the snake's actual length
+ */
+static unsigned int board_setup(unsigned int x_bound, unsigned int y_bound,
+  unsigned int length)
+{
+  coord_t head = COORD_PACK(1, 1);
+
+  if (length > cycle_length(x_bound, y_bound))
+    length = cycle_length(x_bound, y_bound);
+
+  game_srand(&game, rng_next(&board_rng));
+  game_setup(&game, x_bound, y_bound, 1, 1);
+  gamestate_set(&game, GS_RUNNING);
+
+  while (game.snake.length < length)
+  {
+    head = cycle_next(head);
+    snake_grow(&game, COORD_X(head), COORD_Y(head));
+  }
+
+  // make sure the snake didn't just swallow the only piece of food
+  if (game.food.consumed)
+    food_spawn(&game, false);
+
+  return game.snake.length;
+}
+
+/**
+ * function:  velocity_towards
+ * ---------------------------
+ * returns: the velocity that moves the head one step along the cycle
+ */
+static enum velocity_t velocity_towards(coord_t from, coord_t to)
+{
+  if (COORD_X(to) > COORD_X(from))
+    return VEL_RIGHT;
+  else if (COORD_X(to) < COORD_X(from))
+    return VEL_LEFT;
+  else if (COORD_Y(to) > COORD_Y(from))
+    return VEL_DOWN;
+  else
+    return VEL_UP;
+}
+
+
+/*
+ * statistics
+ */
+
+static int compare_ns(const void * a, const void * b)
+{
+  nanosecond_t ns_a = *(const nanosecond_t *) a,
+               ns_b = *(const nanosecond_t *) b;
+
+  return (ns_a > ns_b) - (ns_a < ns_b);
+}
+
+/**
+ * function:  stats_compute
+ * ------------------------
+ * sorts the samples and summarizes them.
+ *
+ * samples: timed samples (reordered)
+ * n:       number of samples
+ * scale:   number of operations each sample covers
+ *
+ * returns: the summary, scaled to nanoseconds per operation
+ */
+static struct bench_stats stats_compute(nanosecond_t * samples, size_t n,
+  unsigned int scale)
+{
+  struct bench_stats stats = { .samples = n };
+  double             total = 0;
+  size_t             i;
+
+  if (0 == n)
+    return stats;
+
+  qsort(samples, n, sizeof(nanosecond_t), compare_ns);
+
+  for (i = 0; i < n; i++)
+    total += samples[i];
+
+  stats.mean_ns = total / n / scale;
+  stats.p50_ns  = samples[n / 2] / scale;
+  stats.p99_ns  = samples[(n * 99) / 100] / scale;
+  stats.max_ns  = samples[n - 1] / scale;
+
+  return stats;
+}
+
+/**
+ * function:  stats_print
+ * ----------------------
+ * prints one benchmark result, as a table row or as a CSV record.
+ */
+static void stats_print(const char * name, unsigned int x_bound,
+  unsigned int y_bound, const char * param, struct bench_stats stats)
+{
+  if (csv_output)
+  {
+    printf("%s,%u,%u,%s,%zu,%.1f,%llu,%llu,%llu\n",
+      name, x_bound, y_bound, param, stats.samples, stats.mean_ns,
+      (unsigned long long) stats.p50_ns,
+      (unsigned long long) stats.p99_ns,
+      (unsigned long long) stats.max_ns);
+  }
+  else
+  {
+    printf("%-18s %5ux%-5u %-20s %8zu %10.1f %8llu %8llu %10llu\n",
+      name, x_bound, y_bound, param, stats.samples, stats.mean_ns,
+      (unsigned long long) stats.p50_ns,
+      (unsigned long long) stats.p99_ns,
+      (unsigned long long) stats.max_ns);
+  }
+
+  fflush(stdout);
+}
+
+
+/*
+ * benchmarks
+ */
+
+/**
+ * function:  bench_game_update
+ * ----------------------------
+ * times game_update() while the snake follows the cycle.
+ */
+static void bench_game_update(unsigned int x_bound, unsigned int y_bound,
+  unsigned int length)
+{
+  char   param[32];
+  size_t i;
+
+  length = board_setup(x_bound, y_bound, length);
+
+  for (i = 0; i < n_samples && GS_RUNNING == game.state; i++)
+  {
+    nanosecond_t start_ns;
+    coord_t      head = SNAKE_HEAD(&game.snake);
+
+    snake_set_velocity(&game, velocity_towards(head, cycle_next(head)));
+
+    start_ns = get_time_ns();
+    game_update(&game);
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  snprintf(param, sizeof(param), "len=%u", length);
+  stats_print("game_update", x_bound, y_bound, param,
+    stats_compute(sample_ns, i, 1));
+
+  game_unset(&game);
+}
+
+/**
+ * function:  bench_food_spawn
+ * ---------------------------
+ * times food_spawn() with the given fraction of the interior filled.
+ */
+static void bench_food_spawn(unsigned int x_bound, unsigned int y_bound,
+  double fill_ratio)
+{
+  char         param[32];
+  unsigned int length;
+  size_t       i;
+
+  // always leave at least one cell free for the food
+  length = fill_ratio * cycle_length(x_bound, y_bound);
+
+  if (length >= cycle_length(x_bound, y_bound))
+    length = cycle_length(x_bound, y_bound) - 1;
+
+  board_setup(x_bound, y_bound, length > 0 ? length : 1);
+
+  for (i = 0; i < n_samples; i++)
+  {
+    nanosecond_t start_ns = get_time_ns();
+
+    food_spawn(&game, false);
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  snprintf(param, sizeof(param), "fill=%.3f",
+    (double) game.snake.length / ((x_bound - 2) * (y_bound - 2)));
+  stats_print("food_spawn", x_bound, y_bound, param,
+    stats_compute(sample_ns, i, 1));
+
+  game_unset(&game);
+}
+
+/**
+ * function:  bench_frame_capture
+ * ------------------------------
+ * times frame_capture(), the game thread's cost of handing a frame to the
+ * render thread, while the snake follows the cycle.
+ */
+static void bench_frame_capture(unsigned int x_bound, unsigned int y_bound)
+{
+  char   param[32];
+  size_t i;
+
+  board_setup(x_bound, y_bound, 256);
+
+  if (!frame_setup(&frame, x_bound, y_bound))
+    return;
+
+  for (i = 0; i < n_samples && GS_RUNNING == game.state; i++)
+  {
+    nanosecond_t start_ns;
+    coord_t      head = SNAKE_HEAD(&game.snake);
+
+    snake_set_velocity(&game, velocity_towards(head, cycle_next(head)));
+    game_update(&game);
+
+    start_ns = get_time_ns();
+    frame_capture(&frame, &game);
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  snprintf(param, sizeof(param), "len=%u", game.snake.length);
+  stats_print("frame_capture", x_bound, y_bound, param,
+    stats_compute(sample_ns, i, 1));
+
+  frame_unset(&frame);
+  game_unset(&game);
+}
+
+/**
+ * function:  bench_set_velocity
+ * -----------------------------
+ * times snake_set_velocity() in batches of BENCH_VELOCITY_BATCH calls.
+ */
+static void bench_set_velocity(void)
+{
+  const enum velocity_t turns[4] = { VEL_UP, VEL_RIGHT, VEL_DOWN, VEL_LEFT };
+
+  size_t n_batches = n_samples / BENCH_VELOCITY_BATCH + 1;
+  size_t i, j;
+  char   param[32];
+
+  board_setup(80, 24, 4);
+
+  for (i = 0; i < n_batches; i++)
+  {
+    nanosecond_t start_ns = get_time_ns();
+
+    for (j = 0; j < BENCH_VELOCITY_BATCH; j++)
+      snake_set_velocity(&game, turns[j % 4]);
+
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  snprintf(param, sizeof(param), "batch=%d", BENCH_VELOCITY_BATCH);
+  stats_print("snake_set_velocity", 80, 24, param,
+    stats_compute(sample_ns, n_batches, BENCH_VELOCITY_BATCH));
+
+  game_unset(&game);
+}
+
+/**
+ * function:  bench_rng
+ * --------------------
+ * times a bounded random draw (as food_spawn() makes one) in batches of
+ * BENCH_RNG_BATCH draws, with the game's generator or with libc's rand_r()
+ * and a modulo, which it replaced.
+ *
+ * is_libc: time rand_r() instead of rng_bounded()
+ */
+static void bench_rng(bool is_libc)
+{
+  const uint32_t bound = (80 - 2) * (24 - 2);
+
+  size_t            n_batches  = n_samples / BENCH_RNG_BATCH + 1;
+  struct rng        rng;
+  unsigned int      rand_state = 1;
+  volatile uint32_t sink;
+  size_t            i, j;
+  char              param[32];
+
+  rng_seed(&rng, 1);
+
+  for (i = 0; i < n_batches; i++)
+  {
+    nanosecond_t start_ns = get_time_ns();
+
+    if (is_libc)
+    {
+      for (j = 0; j < BENCH_RNG_BATCH; j++)
+        sink = rand_r(&rand_state) % bound;
+    }
+    else
+    {
+      for (j = 0; j < BENCH_RNG_BATCH; j++)
+        sink = rng_bounded(&rng, bound);
+    }
+
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  (void) sink;
+
+  snprintf(param, sizeof(param), "%s", is_libc ? "rand_r" : "xoshiro256**");
+  stats_print("rng_bounded", 80, 24, param,
+    stats_compute(sample_ns, n_batches, BENCH_RNG_BATCH));
+}
+
+
+/**
+ * function:  bench_timer_refire
+ * -----------------------------
+ * fire function of bench_timer_wheel's timers: schedules the timer again, a
+ * random number of ticks (up to two turns of the wheel) away.
+ */
+static void bench_timer_refire(void * ctx, unsigned int kind, uint32_t arg)
+{
+  timer_wheel_schedule(ctx, 1 + rng_bounded(&board_rng,
+    2 * TIMER_WHEEL_SLOTS), kind, arg, NULL);
+}
+
+/**
+ * function:  bench_timer_wheel
+ * ----------------------------
+ * times timer_wheel_advance() in batches of BENCH_TIMER_BATCH ticks, with
+ * the given number of timers pending (each is rescheduled when it fires).
+ */
+static void bench_timer_wheel(unsigned int pending)
+{
+  struct timer_wheel wheel;
+
+  size_t n_batches = n_samples / BENCH_TIMER_BATCH + 1;
+  size_t i, j;
+  char   param[32];
+
+  timer_wheel_init(&wheel, bench_timer_refire, &wheel);
+
+  for (i = 0; i < pending; i++)
+    bench_timer_refire(&wheel, 0, 0);
+
+  for (i = 0; i < n_batches; i++)
+  {
+    nanosecond_t start_ns = get_time_ns();
+
+    for (j = 0; j < BENCH_TIMER_BATCH; j++)
+      timer_wheel_advance(&wheel);
+
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  snprintf(param, sizeof(param), "pending=%u", pending);
+  stats_print("timer_wheel", 0, 0, param,
+    stats_compute(sample_ns, n_batches, BENCH_TIMER_BATCH));
+}
+
+
+/**
+ * function:  bench_graphics_update
+ * --------------------------------
+ * times graphics_update() with the given backend while the snake follows the
+ * cycle. The terminal output goes to /dev/null, so this measures composing
+ * and encoding frames rather than the terminal. The param column reports
+ * bytes written per frame, or cells emitted per frame if the backend can't
+ * tell how much it wrote.
+ *
+ * backend_id:  backend to render with
+ * is_full:     redraw the whole screen every frame instead of only what
+ *                changed
+ */
+static void bench_graphics_update(enum graphics_backend_t backend_id,
+  bool is_full)
+{
+  struct graphics_stats before, after;
+  unsigned int          x_bound, y_bound;
+  char                  param[32];
+  size_t                n_frames, i;
+  int                   stdout_fd, null_fd;
+
+  n_frames = (n_samples < BENCH_GRAPHICS_LIMIT) ? n_samples
+                                                : BENCH_GRAPHICS_LIMIT;
+
+  // send the backend's output to /dev/null, sized through the environment
+  fflush(stdout);
+  stdout_fd = dup(STDOUT_FILENO);
+  null_fd   = open("/dev/null", O_WRONLY);
+
+  if (stdout_fd < 0 || null_fd < 0)
+  {
+    if (stdout_fd >= 0)
+      close(stdout_fd);
+
+    if (null_fd >= 0)
+      close(null_fd);
+
+    return;
+  }
+
+  dup2(null_fd, STDOUT_FILENO);
+  close(null_fd);
+
+  setenv("TERM", "xterm", 0);
+
+  graphics_setup(backend_id, &x_bound, &y_bound);
+  board_setup(x_bound, y_bound, 256);
+
+  // put stdout back before giving up, or every later result is lost
+  if (!frame_setup(&frame, x_bound, y_bound))
+  {
+    graphics_unset();
+    game_unset(&game);
+
+    fflush(stdout);
+    dup2(stdout_fd, STDOUT_FILENO);
+    close(stdout_fd);
+
+    return;
+  }
+
+  // the first frame draws everything, don't count it
+  frame_capture(&frame, &game);
+  graphics_update(&frame);
+  graphics_get_stats(&before);
+
+  for (i = 0; i < n_frames && GS_RUNNING == game.state; i++)
+  {
+    nanosecond_t start_ns;
+    coord_t      head = SNAKE_HEAD(&game.snake);
+
+    snake_set_velocity(&game, velocity_towards(head, cycle_next(head)));
+    game_update(&game);
+
+    frame_capture(&frame, &game);
+
+    if (is_full)
+      graphics_invalidate();
+
+    start_ns = get_time_ns();
+    graphics_update(&frame);
+    sample_ns[i] = get_time_ns() - start_ns;
+  }
+
+  graphics_get_stats(&after);
+  graphics_unset();
+
+  fflush(stdout);
+  dup2(stdout_fd, STDOUT_FILENO);
+  close(stdout_fd);
+
+  if (after.bytes > before.bytes)
+    snprintf(param, sizeof(param), "%s:%s:%.0fB/f",
+      graphics_backend_to_string(backend_id), is_full ? "full" : "diff",
+      (double) (after.bytes - before.bytes) / (i ? i : 1));
+  else
+    snprintf(param, sizeof(param), "%s:%s:%.0fc/f",
+      graphics_backend_to_string(backend_id), is_full ? "full" : "diff",
+      (double) (after.cells - before.cells) / (i ? i : 1));
+
+  stats_print("graphics_update", x_bound, y_bound, param,
+    stats_compute(sample_ns, i, 1));
+
+  frame_unset(&frame);
+  game_unset(&game);
+}
+
+
+void usage(const char * prog_name)
+{
+  fprintf(stderr,
+    "usage: %s [-c] [-n samples] [-m max_board]\n"
+    "\n"
+    "  -c            print results as CSV\n"
+    "  -n samples    timed samples per benchmark (default: %d)\n"
+    "  -m max_board  skip boards wider or taller than this\n",
+    prog_name, BENCH_DEFAULT_SAMPLES
+  );
+}
+
+/**
+ * function:  main
+ * ---------------
+ * tty-snake benchmark entry-point.
+ *
+ * returns: 0 on success, else 1.
+ */
+int main(int argc, char **argv)
+{
+  unsigned int max_board = 0xFFFF;
+  size_t       i, j;
+  int          opt;
+
+  while ((opt = getopt(argc, argv, "cn:m:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        csv_output = true;
+        break;
+
+      case 'n':
+        n_samples = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'm':
+        max_board = strtoul(optarg, NULL, 10);
+        break;
+
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  sample_ns = malloc((n_samples + 1) * sizeof(nanosecond_t));
+
+  if (!sample_ns)
+    return 1;
+
+  // fixed seed so that runs are comparable between commits
+  rng_seed(&board_rng, 1);
+
+  if (csv_output)
+    printf("benchmark,x_bound,y_bound,param,samples,mean_ns,p50_ns,p99_ns,max_ns\n");
+  else
+    printf("%-18s %11s %-20s %8s %10s %8s %8s %10s\n",
+      "benchmark", "board", "param", "samples", "mean_ns", "p50_ns", "p99_ns",
+      "max_ns");
+
+  for (i = 0; i < sizeof(board_sizes) / sizeof(board_sizes[0]); i++)
+  {
+    if (board_sizes[i][0] > max_board || board_sizes[i][1] > max_board)
+      continue;
+
+    for (j = 0; j < sizeof(snake_lengths) / sizeof(snake_lengths[0]); j++)
+    {
+      // skip lengths that would be clamped to the same snake
+      if (j > 0 && snake_lengths[j - 1] >= (board_sizes[i][0] - 2)
+        * (board_sizes[i][1] - 2))
+        break;
+
+      bench_game_update(board_sizes[i][0], board_sizes[i][1], snake_lengths[j]);
+    }
+  }
+
+  for (i = 0; i < sizeof(board_sizes) / sizeof(board_sizes[0]); i++)
+  {
+    if (board_sizes[i][0] > max_board || board_sizes[i][1] > max_board)
+      continue;
+
+    for (j = 0; j < sizeof(fill_ratios) / sizeof(fill_ratios[0]); j++)
+      bench_food_spawn(board_sizes[i][0], board_sizes[i][1], fill_ratios[j]);
+  }
+
+  for (i = 0; i < sizeof(board_sizes) / sizeof(board_sizes[0]); i++)
+  {
+    if (board_sizes[i][0] > max_board || board_sizes[i][1] > max_board)
+      continue;
+
+    bench_frame_capture(board_sizes[i][0], board_sizes[i][1]);
+  }
+
+  bench_set_velocity();
+
+  bench_rng(false);
+  bench_rng(true);
+
+  bench_timer_wheel(0);
+  bench_timer_wheel(TIMER_WHEEL_MAX);
+
+  // every backend renders an 80x24 terminal (ncurses only sizes itself once
+  // per process)
+  setenv("COLUMNS", "80", 1);
+  setenv("LINES", "24", 1);
+
+  for (i = 0; i < GRAPHICS_BACKEND_COUNT; i++)
+  {
+    bench_graphics_update(i, false);
+    bench_graphics_update(i, true);
+  }
+
+  free(sample_ns);
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * arena.h
+ *
+ * tty-snake memory arena (a single block that allocations are carved from).
+ *
+ * An arena takes one block from the allocator when it is set up, and hands
+ * out pieces of it by bumping an offset. Pieces are never freed one by one:
+ * resetting the arena gives back all of them at once, without touching the
+ * allocator, so whatever lives in it can be rebuilt in the same memory.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+// alignment of every piece carved from an arena
+#define ARENA_ALIGN 16
+
+// space a piece of the given size takes up in an arena (see arena_alloc)
+#define ARENA_SIZE(size) \
+  (((size_t) (size) + (ARENA_ALIGN - 1)) & ~((size_t) ARENA_ALIGN - 1))
+
+#include <global.h>
+
+/**
+ * struct:  arena
+ * --------------
+ * base:  the arena's block (NULL if not set up)
+ * size:  size of the block in bytes
+ * used:  bytes handed out since the arena was set up or last reset
+ */
+struct arena
+{
+  unsigned char * base;
+  size_t          size;
+  size_t          used;
+};
+
+// function declarations
+bool   arena_setup(struct arena * arena, size_t size);
+void * arena_alloc(struct arena * arena, size_t size);
+void   arena_reset(struct arena * arena);
+size_t arena_mark(const struct arena * arena);
+void   arena_rewind(struct arena * arena, size_t mark);
+void   arena_unset(struct arena * arena);
+
+#endif // ARENA_H
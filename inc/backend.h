@@ -0,0 +1,50 @@
+/**
+ * backend.h
+ *
+ * tty-snake renderer backends (terminal output and keyboard input).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <global.h>
+#include <screen.h>
+
+/**
+ * struct:  graphics_backend
+ * -------------------------
+ * a way of driving the terminal. The graphics module composes frames into
+ * the damage-tracked screen and only hands the backend cells that changed.
+ *
+ * name:      name used to select the backend at startup
+ * setup:     takes over the terminal and reports its size
+ * resize:    adapts to a new terminal size (the screen must be redrawn)
+ * emit:      writes one changed cell (see screen_emit_fn)
+ * flush:     puts the cells emitted since the last flush on the terminal,
+ *              returning the number of bytes written (0 if unknown)
+ * read_key:  reads a key without blocking (ERR if there is none); arrow
+ *              keys are reported as ncurses' KEY_UP, KEY_DOWN, ...
+ * unset:     restores the terminal
+ */
+struct graphics_backend
+{
+  const char * name;
+
+  bool   (*setup)(unsigned int * width, unsigned int * height);
+  bool   (*resize)(unsigned int * width, unsigned int * height);
+  void   (*emit)(unsigned int x, unsigned int y, scell_t cell);
+  size_t (*flush)(void);
+  int    (*read_key)(void);
+  void   (*unset)(void);
+};
+
+extern const struct graphics_backend ncurses_backend; // backend_ncurses.c
+extern const struct graphics_backend ansi_backend;    // backend_ansi.c
+
+// function declarations
+int  backend_read_stdin_key(void);
+void backend_reset_keys(void);
+
+#endif // BACKEND_H
@@ -9,19 +9,74 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
-#define ENGINE_TICKRATE   30 // max ticks per second
-//#define TICKRATE_ENGINE   30 // max ticks per second
-//#define TICKRATE_GAME     30
-//#define TICKRATE_GRAPHICS 30
+// game updates per second at speed level 0, and the updates per second
+// added by every speed level (see game_speed_level)
+#define ENGINE_SIM_RATE      30
+#define ENGINE_SIM_RATE_STEP 3
 
-#define PAUSE_KEY 'p'
-#define QUIT_KEY  'q'
+// max frames drawn per second (a frame is only drawn when it changed)
+#define ENGINE_RENDER_RATE   60
+
+// stdin polls per second, when stdin can't be waited on (e.g. a file)
+#define ENGINE_INPUT_RATE    240
+
+// most events handled per wakeup (stdin, signalfd, timerfd)
+#define ENGINE_MAX_EVENTS 4
+
+// ticks run between checks for keys and signals when not throttled
+#define ENGINE_FAST_FORWARD_TICKS 256
+
+#define PAUSE_KEY   'p'
+#define QUIT_KEY    'q'
+#define RESTART_KEY 'r'
+#define HUD_KEY     'h'
 
 #include <global.h>
+#include <game.h>
+#include <graphics.h>
+#include <ticker.h>
+
+/**
+ * struct:  engine_config
+ * ----------------------
+ * seed:               value the randomizer was seeded with
+ * record_path:        file to record the session's input to (NULL if none)
+ * replay_path:        replay file to play back instead of reading the
+ *                       keyboard (NULL to play live)
+ * replay_unthrottled: play the replay back as fast as possible
+ * replay_headless:    play the replay back without a terminal
+ * replay_seek_tick:   tick to start watching the replay from
+ * catchup:            what to do about ticks missed because the previous
+ *                       tick overran
+ * backend:            how to drive the terminal
+ * phase_stats_path:   file to write the phase timings to when the engine
+ *                       stops (NULL for stderr, see USE_PHASE_STATS)
+ * trace_path:         file to write a trace of the engine to when it stops
+ *                       (NULL to not trace, see USE_TRACE)
+ * turn_max_age:       age at which queued turns are dropped (see turn_queue;
+ *                       replays use the recorded one)
+ */
+struct engine_config
+{
+  uint64_t     seed;
+  const char * record_path;
+  const char * replay_path;
+  bool         replay_unthrottled;
+  bool         replay_headless;
+  uint64_t     replay_seek_tick;
+
+  enum ticker_catchup_t   catchup;
+  enum graphics_backend_t backend;
+  const char *            phase_stats_path;
+  const char *            trace_path;
+  unsigned int            turn_max_age;
+};
 
 extern bool is_engine_running;
 
-void engine_start(void);
+void engine_start(const struct engine_config * config);
 void engine_stop(void);
 
+bool engine_handle_input(struct game_ctx * game, int input_ch);
+
 #endif // ENGINE_H
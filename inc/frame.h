@@ -0,0 +1,121 @@
+/**
+ * frame.h
+ *
+ * tty-snake frame snapshots, and the lock-free triple buffer that hands them
+ * from the simulation thread to the render thread.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+// marks the exchange's latest frame as not drawn yet
+#define FRAME_EXCHANGE_FRESH 0x4u
+
+// index of the (x, y) cell in a frame's grid
+#define FRAME_CELL_AT(f,x,y) ((f)->grid[(size_t) (y) * (f)->x_bound + (x)])
+
+#include <stdatomic.h> // atomic_uint
+
+#include <global.h>
+#include <game.h>
+
+/**
+ * struct:  frame_hud
+ * ------------------
+ * what the engine measured for the performance HUD (see hud.h).
+ *
+ * is_shown:    whether the HUD is shown
+ * tick_rate:   game updates per second
+ * tick_p99_ns: 99th percentile game update time
+ */
+struct frame_hud
+{
+  bool         is_shown;
+  unsigned int tick_rate;
+  nanosecond_t tick_p99_ns;
+};
+
+/**
+ * struct:  frame
+ * --------------
+ * compact copy of everything a frame shows, captured from the game. The
+ * grid is allocated once for the board size and reused by every capture.
+ *
+ * state:         gamestate
+ * score:         score
+ * won:           true if the snake filled the board
+ * powerup:       the snake's active powerup
+ * food_powerup:  powerup the food carries
+ * head:          the snake's head
+ * tail:          the snake's tail
+ * length:        the snake's length
+ * x_bound:       game area width (including the boundary)
+ * y_bound:       game area height (including the boundary)
+ * grid:          copy of the game's occupancy grid
+ * hud:           the performance HUD (set by the engine, not captured)
+ */
+struct frame
+{
+  enum gamestate_t state;
+  unsigned int     score;
+  bool             won;
+  enum powerup_t   powerup;
+  enum powerup_t   food_powerup;
+
+  coord_t      head;
+  coord_t      tail;
+  unsigned int length;
+
+  unsigned int    x_bound;
+  unsigned int    y_bound;
+  unsigned char * grid;
+
+  struct frame_hud hud;
+};
+
+/**
+ * struct:  frame_exchange
+ * -----------------------
+ * triple buffer of frames with a single producer (the simulation thread)
+ * and a single consumer (the render thread). Each side owns one frame, and
+ * the third holds the latest published frame; publishing and taking the
+ * latest frame swap frames with it atomically, so neither side ever waits
+ * for the other. Frames published while the consumer is busy simply replace
+ * each other.
+ *
+ * frames:    the three frames
+ * latest:    index of the latest published frame, with FRAME_EXCHANGE_FRESH
+ *              set until the consumer takes it
+ * back:      frame being captured (producer only)
+ * front:     frame being drawn (consumer only)
+ * has_front: whether front holds a published frame (consumer only)
+ * published: number of frames published (producer only)
+ */
+struct frame_exchange
+{
+  struct frame frames[3];
+
+  atomic_uint  latest;
+  unsigned int back;
+  unsigned int front;
+  bool         has_front;
+
+  uint64_t published;
+};
+
+// function declarations
+bool frame_setup(struct frame * frame, unsigned int x_bound,
+  unsigned int y_bound);
+void frame_capture(struct frame * frame, const struct game_ctx * game);
+void frame_unset(struct frame * frame);
+
+bool                 frame_exchange_setup(struct frame_exchange * exchange,
+                       unsigned int x_bound, unsigned int y_bound);
+struct frame *       frame_exchange_back(struct frame_exchange * exchange);
+void                 frame_exchange_publish(struct frame_exchange * exchange);
+const struct frame * frame_exchange_latest(struct frame_exchange * exchange);
+void                 frame_exchange_unset(struct frame_exchange * exchange);
+
+#endif // FRAME_H
@@ -12,17 +12,51 @@
 #define ARE_COLLIDING(ent_a,ent_b) \
   ((ent_a)->x == (ent_b)->x && (ent_a)->y == (ent_b)->y)
 
-#define IS_MOVEMENT_TICK(tc) \
-  ((bool) (((tc) % 2) == 0))
+// packed board coordinates (x in the low 16 bits, y in the high 16 bits)
+#define COORD_PACK(x,y) \
+  ((coord_t) ((((coord_t) (y)) << 16) | ((coord_t) (x) & 0xFFFF)))
+
+// whether a game can be set up on a board: coordinates are 16 bits, and
+// the interior needs a free cell besides the snake's for the first food
+#define GAME_BOUNDS_VALID(x,y) \
+  ((x) >= 3 && (y) >= 3 && (x) <= 0xFFFF && (y) <= 0xFFFF \
+    && (uint64_t) ((x) - 2) * ((y) - 2) >= 2)
+
+#define COORD_X(c) ((unsigned int) ((c) & 0xFFFF))
+#define COORD_Y(c) ((unsigned int) ((c) >> 16))
+
+// snake body access (segment 0 is the head, segment length - 1 the tail)
+#define SNAKE_SEG(s,i) \
+  ((s)->body[((s)->head + (i)) % (s)->capacity])
+
+#define SNAKE_HEAD(s) ((s)->body[(s)->head])
+#define SNAKE_TAIL(s) SNAKE_SEG((s), (s)->length - 1)
+
+// most direction changes that can wait for a movement at once
+#define TURN_QUEUE_SIZE 2
+
+// default number of updates a queued direction change waits before it is
+// dropped as stale (see struct turn_queue)
+#define TURN_DEFAULT_MAX_AGE 3
+
+// snake segments gained per speed level, and the highest speed level
+#define GAME_LEVEL_LENGTH 8
+#define GAME_MAX_LEVEL    10
 
 // average # of powerups per 100 food spawns
 #define PU_SPAWN_PERCENTAGE 10
 
-// powerup durations (in seconds)
-#define PU_SINGLESTEP_DUR 10
-#define PU_NOGROW_DUR     15
+// powerup durations (in game updates while running; 10 and 15 seconds at the
+// base update rate, see ENGINE_SIM_RATE)
+#define PU_SINGLESTEP_DUR 300
+#define PU_NOGROW_DUR     450
 
 #include <global.h>
+#include <arena.h>
+#include <rng.h>
+#include <timerwheel.h>
+
+typedef uint32_t coord_t;
 
 /**
  * enum:  gamestate_t
@@ -44,6 +78,24 @@ enum gamestate_t
   GS_COUNT
 };
 
+/**
+ * enum:  cell_t
+ * -------------
+ * contents of a single board cell, as stored in the occupancy grid.
+ *
+ * CELL_EMPTY:  nothing occupies the cell
+ * CELL_WALL:   the cell is part of the game area boundary
+ * CELL_SNAKE:  a snake segment occupies the cell
+ * CELL_FOOD:   the (unconsumed) food occupies the cell
+ */
+enum cell_t
+{
+  CELL_EMPTY = 0,
+  CELL_WALL,
+  CELL_SNAKE,
+  CELL_FOOD
+};
+
 /**
  * enum:  velocity_t
  * -----------------
@@ -71,6 +123,23 @@ enum powerup_t
   PU_COUNT       // Simply stores the number of powerup_t items
 }; // TODO let PU_NONE be 0, and PU_COUNT somehow be defined?
 
+// bit of a powerup in a snake's set of active powerups
+#define PU_BIT(pu) (1u << (pu))
+
+/**
+ * enum:  game_timer_t
+ * -------------------
+ * what a game's timer does when it fires (see struct timer_wheel).
+ *
+ * GAME_TIMER_POWERUP:  a powerup (the timer's argument) expires
+ * GAME_TIMER_COUNT:    number of timer kinds
+ */
+enum game_timer_t
+{
+  GAME_TIMER_POWERUP = 0,
+  GAME_TIMER_COUNT
+};
+
 /**
  * struct:  ent_food
  * -----------------
@@ -89,42 +158,64 @@ struct ent_food
 /**
  * struct:  ent_snake
  * ------------------
- * TODO - Documentation
+ * the snake's body is stored as a ring buffer of packed coordinates, sized
+ * to the board so that moving never has to allocate. A new head is pushed
+ * at the index before the current head, so segment i lives at
+ * body[(head + i) % capacity].
+ *
+ * length:          number of live segments
+ * dying:           number of segments popped from the tail during the last
+ *                    update which are still in the ring buffer (directly
+ *                    after the tail) so that the renderer can erase them
+ * powerup:         the most recently activated powerup still active
+ *                    (PU_NONE if none is)
+ * powerups:        set of active powerups (see PU_BIT), which stack
+ * powerup_timers:  handle of each active powerup's expiry timer
+ * capacity:        number of coordinates the body can hold
+ * head:            index of the head segment in body
+ * body:            ring buffer of packed segment coordinates
  */
 struct ent_snake
 {
   unsigned int length;
-  nanosecond_t powerup_expire_ns;
+  unsigned int dying;
 
   enum velocity_t velocity;
   enum velocity_t prev_velocity;
   enum powerup_t  powerup;
+  unsigned int    powerups;
+  unsigned int    powerup_timers[PU_COUNT];
 
-  struct ent_snake_seg * head;
-  struct ent_snake_seg * tail;
+  unsigned int capacity;
+  unsigned int head;
+  coord_t    * body;
 };
 
 /**
- * struct:  ent_snake_seg
- * ----------------------
- * TODO - Documentation
+ * struct:  turn_queue
+ * -------------------
+ * direction changes waiting for the snake's next movement, oldest first.
+ * Each movement applies one of them, so turns pressed in quick succession
+ * (e.g. up, then left) aren't lost by overwriting each other. Repeated and
+ * backtracking turns are never queued.
+ *
+ * velocities:  queued velocities
+ * ticks:       game tick_count at which each of them was queued
+ * count:       number of queued turns
+ * max_age:     turns that waited for more than max_age updates are dropped
+ *                instead of applied (e.g. keys read late after a stall)
  */
-struct ent_snake_seg
+struct turn_queue
 {
-  bool dying;
-
-  unsigned int x;
-  unsigned int y;
-
-  struct ent_snake_seg * prev; // NULL if head
-  struct ent_snake_seg * next; // NULL if tail
+  enum velocity_t velocities[TURN_QUEUE_SIZE];
+  unsigned int    ticks[TURN_QUEUE_SIZE];
+  unsigned int    count;
+  unsigned int    max_age;
 };
 
 /**
  * struct:  game_updatecycle_info
  * ------------------------------
- * start_ns:  the nanosecond at which this update cycle began
- *
  * snake_dx:            the change in the snake's x coordinate
  * snake_dy:            the change in the snake's y coordinate
  * snake_can_grow:      whether the snake grows on food consumption
@@ -135,9 +226,6 @@ struct ent_snake_seg
  */
 struct game_updatecycle_info
 {
-  // update cycle information
-  nanosecond_t start_ns;
-
   // snake information
   int             snake_dx;
   int             snake_dy;
@@ -146,26 +234,89 @@ struct game_updatecycle_info
   enum velocity_t snake_new_velocity;
 };
 
-// game status
-extern enum gamestate_t game_state;
-extern unsigned int     game_score;
+/**
+ * struct:  game_ctx
+ * -----------------
+ * everything that makes up a single game. Nothing in the game module is
+ * process-wide, so any number of games can run side by side (one thread may
+ * only update a given game at a time).
+ *
+ * state:       current gamestate
+ * score:       current score
+ * won:         true if the snake filled the board
+ * tick_count:  number of game updates so far
+ * x_bound:     game area width (including the boundary)
+ * y_bound:     game area height (including the boundary)
+ * init_x:      x coordinate the snake starts at
+ * init_y:      y coordinate the snake starts at
+ * turns:       direction changes waiting for the snake's next movement
+ * grid:        occupancy grid (one enum cell_t per cell)
+ * free_cells:  grid index of every empty interior cell, in
+ *                free_cells[0 .. free_count)
+ * free_pos:    maps a grid index to its slot in free_cells
+ * timers:      timed effects (e.g. powerups expiring), counted in updates
+ *                while the game is running
+ * rng:         randomizer (see game_srand)
+ * arena:       holds the grid, the free-cell index and the snake's body,
+ *                which are carved from it again on every restart
+ */
+struct game_ctx
+{
+  // game status
+  enum gamestate_t state;
+  unsigned int     score;
+  bool             won;
+  unsigned int     tick_count;
+
+  // game area bounds
+  unsigned int x_bound;
+  unsigned int y_bound;
+  unsigned int init_x;
+  unsigned int init_y;
 
-// game area bounds
-extern unsigned int game_x_bound;
-extern unsigned int game_y_bound;
+  // entities
+  struct ent_food   food;
+  struct ent_snake  snake;
+  struct turn_queue turns;
 
-// entities
-extern struct ent_food  * food;
-extern struct ent_snake * snake;
+  // occupancy grid and free-cell index
+  unsigned char * grid;
+  unsigned int  * free_cells;
+  unsigned int  * free_pos;
+  unsigned int    free_count;
+
+  unsigned int       powerup_durations[PU_COUNT];
+  struct timer_wheel timers;
+  struct rng         rng;
+  struct arena       arena;
+};
 
 // function declarations
-void game_setup(unsigned int init_x, unsigned int init_y);
-bool game_update(void);
-void game_unset(void);
+void game_setup(struct game_ctx * game, unsigned int x_bound,
+  unsigned int y_bound, unsigned int init_x, unsigned int init_y);
+void game_restart(struct game_ctx * game);
+bool game_update(struct game_ctx * game);
+void game_unset(struct game_ctx * game);
+
+enum cell_t  game_cell_at(const struct game_ctx * game,
+  unsigned int x, unsigned int y);
+unsigned int game_speed_level(const struct game_ctx * game);
+void         game_srand(struct game_ctx * game, uint64_t seed);
+
+size_t game_snapshot_size(const struct game_ctx * game);
+void   game_snapshot_prepare(struct game_ctx * game);
+size_t game_snapshot_save(const struct game_ctx * game, void * buf);
+bool   game_snapshot_load(struct game_ctx * game, const void * buf,
+  size_t size);
+
+bool food_spawn(struct game_ctx * game, bool allow_powerup);
 
-void snake_set_velocity(enum velocity_t velocity);
+bool snake_grow(struct game_ctx * game, unsigned int x, unsigned int y);
+void snake_set_velocity(struct game_ctx * game, enum velocity_t velocity);
+bool snake_queue_turn(struct game_ctx * game, enum velocity_t velocity);
 
-bool         gamestate_set(enum gamestate_t gamestate);
+bool         gamestate_set(struct game_ctx * game,
+  enum gamestate_t gamestate);
 const char * gamestate_to_string(enum gamestate_t gamestate);
 
 //const char * velocity_to_string(enum velocity_t velocity);
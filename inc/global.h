@@ -18,6 +18,8 @@
 // compilation options
 #define DEBUG
 //#define USE_KB_LISTEN_THREAD
+//#define USE_PHASE_STATS // time the engine's phases, report when it stops
+//#define USE_TRACE       // allow tracing the engine to a file (see trace.h)
 
 // generic definitions and typedefs
 #ifndef bool
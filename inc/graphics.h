@@ -11,20 +11,20 @@
 
 // snake display settings
 #define ENT_SNAKE_CH        ' '
-#define ENT_SNAKE_ATTR      A_BOLD | A_STANDOUT
+#define ENT_SNAKE_ATTR      SCELL_BOLD | SCELL_STANDOUT
 #define ENT_SNAKE_DISP      ENT_SNAKE_CH | ENT_SNAKE_ATTR
 
 #define ENT_SNAKE_HEAD_CH   'H'
-#define ENT_SNAKE_HEAD_ATTR A_BOLD | A_STANDOUT
+#define ENT_SNAKE_HEAD_ATTR SCELL_BOLD | SCELL_STANDOUT
 #define ENT_SNAKE_HEAD_DISP ENT_SNAKE_HEAD_CH | ENT_SNAKE_HEAD_ATTR
 
 #define ENT_SNAKE_TAIL_CH   'T'
-#define ENT_SNAKE_TAIL_ATTR A_BOLD | A_STANDOUT
+#define ENT_SNAKE_TAIL_ATTR SCELL_BOLD | SCELL_STANDOUT
 #define ENT_SNAKE_TAIL_DISP ENT_SNAKE_TAIL_CH | ENT_SNAKE_TAIL_ATTR
 
 // food display settings
 #define ENT_FOOD_CH         'O' //'•'
-#define ENT_FOOD_ATTR       A_NORMAL
+#define ENT_FOOD_ATTR       SCELL_NORMAL
 #define ENT_FOOD_DISP       ENT_FOOD_CH | ENT_FOOD_ATTR
 
 // powerup display settings
@@ -36,6 +36,15 @@
 #define PU_NOGROW_ATTR      ENT_FOOD_ATTR
 #define PU_NOGROW_DISP      PU_NOGROW_CH | PU_NOGROW_ATTR
 
+// titlebar display settings
+#define TITLEBAR_X          2
+#define TITLEBAR_MAX_LEN    128
+
+// performance HUD display settings (right-aligned in the titlebar)
+#define HUD_RIGHT_MARGIN    2
+#define HUD_MAX_LEN         64
+#define HUD_UNIT_MAX_LEN    16
+
 // popup window dimensions
 #define WIN_STARTING_HEIGHT 6
 #define WIN_STARTING_WIDTH  50
@@ -47,11 +56,57 @@
 #define WIN_GAMEOVER_WIDTH  50
 
 #include <global.h>
+#include <frame.h>
+#include <game.h>
+#include <screen.h>
+
+/**
+ * enum:  graphics_backend_t
+ * -------------------------
+ * how the terminal is driven (see backend.h).
+ *
+ * GRAPHICS_BACKEND_NCURSES:  through ncurses
+ * GRAPHICS_BACKEND_ANSI:     with VT100/ANSI escape sequences, one write()
+ *                              per frame
+ * GRAPHICS_BACKEND_COUNT:    number of backends
+ */
+enum graphics_backend_t
+{
+  GRAPHICS_BACKEND_NCURSES = 0,
+  GRAPHICS_BACKEND_ANSI,
+  GRAPHICS_BACKEND_COUNT
+};
+
+/**
+ * struct:  graphics_stats
+ * -----------------------
+ * frames:  number of updates (frames composed)
+ * flushes: number of frames that changed something on the terminal
+ * cells:   number of cells emitted
+ * bytes:   number of bytes written (0 if the backend doesn't know)
+ */
+struct graphics_stats
+{
+  uint64_t frames;
+  uint64_t flushes;
+  uint64_t cells;
+  uint64_t bytes;
+};
 
 extern bool is_graphics_setup;
 
-void graphics_setup(void);
-void graphics_update(void);
+void graphics_setup(enum graphics_backend_t backend, unsigned int * x_bound,
+  unsigned int * y_bound);
+void graphics_update(const struct frame * frame);
+void graphics_invalidate(void);
+void graphics_resize(void);
 void graphics_unset(void);
 
+int  graphics_getch(void);
+void graphics_get_stats(struct graphics_stats * stats);
+
+enum graphics_backend_t graphics_backend_from_string(const char * name);
+const char *            graphics_backend_to_string(
+  enum graphics_backend_t backend);
+
 #endif // GRAPHICS_H
@@ -0,0 +1,95 @@
+/**
+ * hist.h
+ *
+ * tty-snake fixed-size log-linear (HDR-style) histograms.
+ *
+ * Every power of two is split into HIST_SUB_COUNT linear buckets, so a value
+ * is recorded with a relative error below 1 / HIST_SUB_COUNT, in a fixed
+ * amount of memory and without any floating point.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef HIST_H
+#define HIST_H
+
+// linear buckets per power of two (2^HIST_SUB_BITS)
+#define HIST_SUB_BITS  5
+#define HIST_SUB_COUNT (1u << HIST_SUB_BITS)
+
+// values are clamped below 2^HIST_MAX_BITS (about 18 minutes in ns)
+#define HIST_MAX_BITS  40
+
+#define HIST_BUCKETS   ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+#include <stdio.h> // FILE
+
+#include <global.h>
+
+/**
+ * struct:  hist
+ * -------------
+ * count:   number of values recorded
+ * sum:     sum of the values recorded (unclamped)
+ * max:     largest value recorded (unclamped)
+ * buckets: number of values recorded per bucket (see hist_index)
+ */
+struct hist
+{
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint32_t buckets[HIST_BUCKETS];
+};
+
+/**
+ * function:  hist_index
+ * ---------------------
+ * values below HIST_SUB_COUNT get a bucket each; above, the value's highest
+ * set bit picks a block of HIST_SUB_COUNT buckets and the next HIST_SUB_BITS
+ * bits pick the bucket in it.
+ *
+ * value: the value
+ *
+ * returns: the index of the bucket holding the value
+ */
+static inline unsigned int hist_index(uint64_t value)
+{
+  unsigned int msb;
+
+  if (value < HIST_SUB_COUNT)
+    return (unsigned int) value;
+
+  if (value >> HIST_MAX_BITS)
+    value = ((uint64_t) 1 << HIST_MAX_BITS) - 1;
+
+  msb = 63 - __builtin_clzll(value);
+
+  return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+    + (unsigned int) (value >> (msb - HIST_SUB_BITS)) - HIST_SUB_COUNT;
+}
+
+/**
+ * function:  hist_record
+ * ----------------------
+ * records a value. Only one thread may record into a given histogram.
+ *
+ * hist:  the histogram
+ * value: the value
+ */
+static inline void hist_record(struct hist * hist, uint64_t value)
+{
+  hist->buckets[hist_index(value)]++;
+  hist->count++;
+  hist->sum += value;
+
+  if (value > hist->max)
+    hist->max = value;
+}
+
+// function declarations
+void     hist_reset(struct hist * hist);
+uint64_t hist_percentile(const struct hist * hist, double percentile);
+double   hist_mean(const struct hist * hist);
+
+#endif // HIST_H
@@ -0,0 +1,68 @@
+/**
+ * hud.h
+ *
+ * tty-snake rolling meters for the performance HUD.
+ *
+ * A meter counts events (and an amount, e.g. bytes) and records their
+ * durations over a window of HUD_WINDOW_NS. Recording is constant-time;
+ * rates and percentiles are only computed once per window, when it rolls
+ * over, so the HUD never costs more than the numbers it shows.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef HUD_H
+#define HUD_H
+
+// how long the meters measure before their results are updated
+#define HUD_WINDOW_NS SECONDS
+
+#include <global.h>
+#include <hist.h>
+
+/**
+ * struct:  hud_meter
+ * ------------------
+ * start_ns:    when the current window began
+ * events:      events recorded in the current window
+ * amount:      amount recorded in the current window
+ * durations:   durations recorded in the current window
+ *
+ * rate:        events per second in the last complete window
+ * amount_rate: amount per second in the last complete window
+ * p99_ns:      99th percentile duration in the last complete window
+ */
+struct hud_meter
+{
+  nanosecond_t start_ns;
+  uint64_t     events;
+  uint64_t     amount;
+  struct hist  durations;
+
+  unsigned int rate;
+  uint64_t     amount_rate;
+  nanosecond_t p99_ns;
+};
+
+/**
+ * function:  hud_meter_record
+ * ---------------------------
+ * records an event. Only one thread may record into a given meter.
+ *
+ * meter:       the meter
+ * duration_ns: how long the event took
+ * amount:      amount to add (e.g. bytes written by the event)
+ */
+static inline void hud_meter_record(struct hud_meter * meter,
+  nanosecond_t duration_ns, uint64_t amount)
+{
+  hist_record(&meter->durations, duration_ns);
+  meter->events++;
+  meter->amount += amount;
+}
+
+// function declarations
+void hud_meter_reset(struct hud_meter * meter, nanosecond_t now_ns);
+bool hud_meter_roll(struct hud_meter * meter, nanosecond_t now_ns);
+
+#endif // HUD_H
@@ -0,0 +1,57 @@
+/**
+ * keyring.h
+ *
+ * tty-snake lock-free single-producer/single-consumer ring of key events.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef KEYRING_H
+#define KEYRING_H
+
+// events the ring holds (must be a power of two)
+#define KEYRING_CAPACITY 64
+
+// keeps the producer's and the consumer's index on separate cache lines
+#define KEYRING_CACHE_LINE_SIZE 64
+
+#include <stdatomic.h> // atomic_uint
+
+#include <global.h>
+
+/**
+ * struct:  key_event
+ * ------------------
+ * ch:  the key that was pressed (as returned by getch)
+ */
+struct key_event
+{
+  int ch;
+};
+
+/**
+ * struct:  keyring
+ * ----------------
+ * head and tail count events popped and pushed; they only ever grow and
+ * are masked to index the ring, so head == tail means empty and
+ * tail - head == KEYRING_CAPACITY means full.
+ *
+ * head:    written by the consumer only
+ * tail:    written by the producer only
+ * dropped: events pushed while the ring was full (producer only)
+ * events:  the ring
+ */
+struct keyring
+{
+  atomic_uint head __attribute__((aligned(KEYRING_CACHE_LINE_SIZE)));
+  atomic_uint tail __attribute__((aligned(KEYRING_CACHE_LINE_SIZE)));
+  unsigned int dropped;
+
+  struct key_event events[KEYRING_CAPACITY];
+};
+
+void keyring_init(struct keyring * ring);
+bool keyring_push(struct keyring * ring, const struct key_event * event);
+bool keyring_pop(struct keyring * ring, struct key_event * event);
+
+#endif // KEYRING_H
@@ -0,0 +1,112 @@
+/**
+ * phase.h
+ *
+ * tty-snake per-phase timing of the engine's loop (see USE_PHASE_STATS and
+ * USE_TRACE).
+ *
+ * A phase is timed from the thread's last PHASE_START or PHASE_STOP to the
+ * PHASE_STOP naming it, so back-to-back phases share a clock read. Phases
+ * are recorded into histograms (with USE_PHASE_STATS) and into the trace as
+ * complete spans (with USE_TRACE, when tracing). Without either option, the
+ * macros compile to nothing.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef PHASE_H
+#define PHASE_H
+
+#include <stdio.h> // FILE
+
+#include <global.h>
+#include <hist.h>
+#include <trace.h>
+
+/**
+ * enum:  phase_t
+ * --------------
+ * PHASE_WAIT:    the engine sleeping until its next deadline or event
+ * PHASE_INPUT:   handling the keys and signals that woke it
+ * PHASE_UPDATE:  a single game update (tick)
+ * PHASE_PUBLISH: capturing and publishing a frame for the render thread
+ * PHASE_RENDER:  drawing a frame (on the render thread)
+ * PHASE_COUNT:   number of phases
+ */
+enum phase_t
+{
+  PHASE_WAIT = 0,
+  PHASE_INPUT,
+  PHASE_UPDATE,
+  PHASE_PUBLISH,
+  PHASE_RENDER,
+  PHASE_COUNT
+};
+
+const char * phase_to_string(enum phase_t phase);
+
+#if defined(USE_PHASE_STATS) || defined(USE_TRACE)
+
+#define PHASE_START()               phase_start()
+#define PHASE_STOP(phase)           phase_stop(phase)
+
+extern _Thread_local nanosecond_t phase_mark_ns;
+
+#ifdef USE_PHASE_STATS
+#define PHASE_SET_BUDGET(phase,ns)  (phase_budgets_ns[phase] = (ns))
+
+// each phase is only timed by one thread
+extern struct hist  phase_hists[PHASE_COUNT];
+extern uint64_t     phase_overruns[PHASE_COUNT];
+extern nanosecond_t phase_budgets_ns[PHASE_COUNT];
+
+void phase_reset(void);
+void phase_report(FILE * out, uint64_t missed_ticks, uint64_t dropped_ticks);
+#else
+#define PHASE_SET_BUDGET(phase,ns)  ((void) 0)
+#endif // USE_PHASE_STATS
+
+/**
+ * function:  phase_start
+ * ----------------------
+ * starts timing the calling thread's next phase.
+ */
+static inline void phase_start(void)
+{
+  phase_mark_ns = get_time_ns();
+}
+
+/**
+ * function:  phase_stop
+ * ---------------------
+ * records the time since the calling thread's last phase boundary as a
+ * phase's duration (counting an overrun if it took longer than the phase's
+ * budget) and traces it, then starts timing the next phase.
+ *
+ * phase: the phase that just ended
+ */
+static inline void phase_stop(enum phase_t phase)
+{
+  nanosecond_t now_ns     = get_time_ns(),
+               elapsed_ns = now_ns - phase_mark_ns;
+
+#ifdef USE_PHASE_STATS
+  hist_record(&phase_hists[phase], elapsed_ns);
+
+  if (phase_budgets_ns[phase] && elapsed_ns > phase_budgets_ns[phase])
+    phase_overruns[phase]++;
+#endif
+
+  TRACE_COMPLETE(phase_to_string(phase), phase_mark_ns, elapsed_ns);
+
+  phase_mark_ns = now_ns;
+}
+
+#else
+
+#define PHASE_START()               ((void) 0)
+#define PHASE_STOP(phase)           ((void) 0)
+#define PHASE_SET_BUDGET(phase,ns)  ((void) 0)
+
+#endif // USE_PHASE_STATS || USE_TRACE
+
+#endif // PHASE_H
@@ -0,0 +1,60 @@
+/**
+ * replay.h
+ *
+ * tty-snake input recording and replay module.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// replay file identification
+#define REPLAY_MAGIC         "TSRP"
+#define REPLAY_INDEX_MAGIC   "TSRI"
+#define REPLAY_VERSION       8
+
+// a keyframe is written every this many ticks while recording, so seeking
+// never has to simulate more than this many ticks. A keyframe takes about
+// 140 bytes plus a quarter byte per snake segment, whatever the board size
+// (see game_snapshot_save): an hour of recording at the base tick rate
+// gains roughly 60 kB of keyframes
+#define REPLAY_KEYFRAME_INTERVAL 300
+
+#include <global.h>
+#include <game.h>
+
+/**
+ * struct:  replay_header
+ * ----------------------
+ * everything besides the input needed to reproduce a session.
+ *
+ * seed:              value the game's randomizer was seeded with
+ * x_bound:           board width
+ * y_bound:           board height
+ * keyframe_interval: number of ticks between keyframes
+ * turn_max_age:      age at which queued turns were dropped (see turn_queue)
+ */
+struct replay_header
+{
+  uint64_t     seed;
+  unsigned int x_bound;
+  unsigned int y_bound;
+  unsigned int keyframe_interval;
+  unsigned int turn_max_age;
+};
+
+bool replay_record_open(const struct game_ctx * game, const char * path,
+  const struct replay_header * header);
+void replay_record_input(uint64_t tick, int input_ch);
+void replay_record_keyframe(const struct game_ctx * game, uint64_t tick);
+void replay_record_close(uint64_t tick);
+
+bool replay_play_open(const char * path, struct replay_header * header);
+int  replay_play_input(uint64_t tick);
+bool replay_play_seek(struct game_ctx * game, uint64_t tick,
+  uint64_t * keyframe_tick);
+bool replay_play_is_done(uint64_t tick);
+void replay_play_close(void);
+
+#endif // REPLAY_H
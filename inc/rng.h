@@ -0,0 +1,95 @@
+/**
+ * rng.h
+ *
+ * tty-snake pseudo-random number generator (xoshiro256**).
+ *
+ * Every generator keeps its whole state in a struct rng, so games never
+ * share (or lock) hidden libc state, and a game's draws only depend on its
+ * seed. Bounded draws use Lemire's multiply-shift method, which is unbiased
+ * and almost never divides.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <global.h>
+
+/**
+ * struct:  rng
+ * ------------
+ * s: generator state (must not be all zero, see rng_seed)
+ */
+struct rng
+{
+  uint64_t s[4];
+};
+
+/**
+ * function:  rng_rotl
+ * -------------------
+ * returns: x rotated left by k bits (0 < k < 64)
+ */
+static inline uint64_t rng_rotl(uint64_t x, unsigned int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * function:  rng_next
+ * -------------------
+ * rng: the generator
+ *
+ * returns: the next 64 random bits
+ */
+static inline uint64_t rng_next(struct rng * rng)
+{
+  uint64_t * s      = rng->s;
+  uint64_t   result = rng_rotl(s[1] * 5, 7) * 9,
+             t      = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3]  = rng_rotl(s[3], 45);
+
+  return result;
+}
+
+/**
+ * function:  rng_bounded
+ * ----------------------
+ * draws a number in [0, bound) with every number equally likely (unlike
+ * taking a draw modulo bound).
+ *
+ * rng:   the generator
+ * bound: number of possible results (must not be 0)
+ *
+ * returns: the number drawn
+ */
+static inline uint32_t rng_bounded(struct rng * rng, uint32_t bound)
+{
+  uint64_t m = (rng_next(rng) >> 32) * bound;
+  uint32_t threshold;
+
+  // the low half falling below 2^32 % bound is the only biased case
+  if ((uint32_t) m < bound)
+  {
+    threshold = -bound % bound;
+
+    while ((uint32_t) m < threshold)
+      m = (rng_next(rng) >> 32) * bound;
+  }
+
+  return (uint32_t) (m >> 32);
+}
+
+// function declarations
+uint64_t rng_splitmix64(uint64_t * state);
+void     rng_seed(struct rng * rng, uint64_t seed);
+void     rng_jump(struct rng * rng);
+
+#endif // RNG_H
@@ -0,0 +1,64 @@
+/**
+ * screen.h
+ *
+ * tty-snake damage-tracked screen (shadow framebuffer).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+// line-drawing glyphs, stored in a cell in place of a character
+#define GLYPH_HLINE    0x80
+#define GLYPH_VLINE    0x81
+#define GLYPH_ULCORNER 0x82
+#define GLYPH_URCORNER 0x83
+#define GLYPH_LLCORNER 0x84
+#define GLYPH_LRCORNER 0x85
+
+// cell attributes
+#define SCELL_NORMAL   0x0000
+#define SCELL_BOLD     0x0100
+#define SCELL_STANDOUT 0x0200
+
+// cell access (a character or glyph in the low byte, attributes above it)
+#define SCELL_CH(c)   ((unsigned char) ((c) & 0xFF))
+#define SCELL_ATTR(c) ((scell_t) ((c) & 0xFF00))
+
+// value no frame ever holds, so that a shadow cell holding it is re-emitted
+#define SCELL_INVALID 0xFFFF
+
+#include <global.h>
+
+typedef uint16_t scell_t;
+
+/**
+ * typedef: screen_emit_fn
+ * -----------------------
+ * called by screen_flush for every cell that differs from the last frame
+ * emitted, in row-major order.
+ *
+ * x:     column of the cell
+ * y:     row of the cell
+ * cell:  the cell's new contents
+ */
+typedef void (*screen_emit_fn)(unsigned int x, unsigned int y, scell_t cell);
+
+bool screen_setup(unsigned int width, unsigned int height);
+bool screen_resize(unsigned int width, unsigned int height);
+void screen_invalidate(void);
+void screen_unset(void);
+
+unsigned int screen_width(void);
+unsigned int screen_height(void);
+
+void screen_set(unsigned int x, unsigned int y, scell_t cell);
+void screen_fill(unsigned int x, unsigned int y, unsigned int width,
+  unsigned int height, scell_t cell);
+void screen_text(unsigned int x, unsigned int y, const char * text,
+  scell_t attr);
+
+unsigned int screen_flush(screen_emit_fn emit);
+
+#endif // SCREEN_H
@@ -0,0 +1,113 @@
+/**
+ * sim.h
+ *
+ * tty-snake headless simulation module (runs game logic without a terminal).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+// default headless board size (a standard 80x24 terminal)
+#define SIM_DEFAULT_X_BOUND 80
+#define SIM_DEFAULT_Y_BOUND 24
+
+// character in an input script meaning "no key pressed this tick"
+#define SIM_SCRIPT_NOKEY '.'
+
+#include <global.h>
+#include <game.h>
+
+/**
+ * enum:  sim_policy_t
+ * -------------------
+ * how the simulator generates input for each tick.
+ *
+ * SIM_POLICY_AUTOPILOT:  steer towards the food while avoiding collisions
+ * SIM_POLICY_RANDOM:     press a random direction key each tick
+ * SIM_POLICY_SCRIPT:     replay a fixed key script (one key per tick,
+ *                          repeated from the start when it runs out, unless
+ *                          the snake didn't move during the last pass)
+ * SIM_POLICY_COUNT:      number of policies
+ */
+enum sim_policy_t
+{
+  SIM_POLICY_AUTOPILOT = 0,
+  SIM_POLICY_RANDOM,
+  SIM_POLICY_SCRIPT,
+  SIM_POLICY_COUNT   // number of policies
+};
+
+/**
+ * struct:  sim_config
+ * -------------------
+ * x_bound:      board width (replaces the terminal width)
+ * y_bound:      board height (replaces the terminal height)
+ * max_ticks:    number of game ticks to simulate; games that end early are
+ *                 restarted until this many ticks have run. If 0, only a
+ *                 single game is simulated.
+ * policy:       input generation policy
+ * script:       key script for SIM_POLICY_SCRIPT
+ * seed:         seed every game's seed is drawn from (sim_run only)
+ * turn_max_age: age at which queued turns are dropped (see turn_queue)
+ */
+struct sim_config
+{
+  unsigned int      x_bound;
+  unsigned int      y_bound;
+  uint64_t          max_ticks;
+  enum sim_policy_t policy;
+  const char      * script;
+  uint64_t          seed;
+  unsigned int      turn_max_age;
+};
+
+/**
+ * struct:  sim_result
+ * -------------------
+ * ticks:       number of game ticks simulated
+ * games:       number of games played
+ * wins:        number of games won by filling the board
+ * best_score:  highest score reached by any game
+ * elapsed_ns:  wall-clock duration of the simulation
+ */
+struct sim_result
+{
+  uint64_t     ticks;
+  uint64_t     games;
+  uint64_t     wins;
+  unsigned int best_score;
+  nanosecond_t elapsed_ns;
+};
+
+/**
+ * struct:  sim_game_result
+ * ------------------------
+ * ticks:         number of ticks the game ran for
+ * powerup_ticks: number of those ticks that ended with a powerup active
+ * score:         final score
+ * length:        final snake length
+ * won:           true if the snake filled the board
+ */
+struct sim_game_result
+{
+  uint64_t     ticks;
+  uint64_t     powerup_ticks;
+  unsigned int score;
+  unsigned int length;
+  bool         won;
+};
+
+void sim_run(const struct sim_config * config, struct sim_result * result);
+void sim_play(const struct sim_config * config, struct game_ctx * game,
+  uint64_t seed, uint64_t max_ticks, struct sim_game_result * result);
+void sim_stop(void);
+
+int sim_policy_input(const struct sim_config * config, size_t script_len,
+  const struct game_ctx * game, struct rng * rng, uint64_t tick);
+
+enum sim_policy_t sim_policy_from_string(const char * name);
+const char      * sim_policy_to_string(enum sim_policy_t policy);
+
+#endif // SIM_H
@@ -0,0 +1,78 @@
+/**
+ * ticker.h
+ *
+ * tty-snake fixed-timestep ticker (steps to absolute deadlines).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef TICKER_H
+#define TICKER_H
+
+// clock the deadlines are measured on (timerfds can't wait on
+// CLOCK_MONOTONIC_RAW, see CLOCK_ID)
+#define TICKER_CLOCK_ID CLOCK_MONOTONIC
+
+// default limit on the steps run at once to catch up
+// (TICKER_CATCHUP_SIMULATE)
+#define TICKER_DEFAULT_MAX_STEPS 4
+
+#include <global.h>
+
+/**
+ * enum:  ticker_catchup_t
+ * -----------------------
+ * what to do about deadlines that passed while the previous step overran.
+ *
+ * TICKER_CATCHUP_DROP:      skip them, run a single step
+ * TICKER_CATCHUP_SIMULATE:  run one step for each of them (up to max_steps),
+ *                             so that the simulation keeps up with real time
+ */
+enum ticker_catchup_t
+{
+  TICKER_CATCHUP_DROP = 0,
+  TICKER_CATCHUP_SIMULATE
+};
+
+/**
+ * struct:  ticker
+ * ---------------
+ * deadline n is at origin_ns + n / rate seconds, so rounding and oversleep
+ * never add up. Everything between the next deadline and the current time
+ * is the accumulator of steps that are due.
+ *
+ * rate:      deadlines per second
+ * catchup:   catch-up policy for missed deadlines
+ * max_steps: most steps ticker_advance returns at once
+ *              (TICKER_CATCHUP_SIMULATE)
+ * origin_ns: time of deadline 0 (on TICKER_CLOCK_ID)
+ * deadline:  number of the next deadline
+ * steps:     number of steps run so far
+ * missed:    number of deadlines that passed before the previous step ended
+ * dropped:   number of missed deadlines that were skipped without a step
+ */
+struct ticker
+{
+  unsigned int          rate;
+  enum ticker_catchup_t catchup;
+  unsigned int          max_steps;
+
+  nanosecond_t origin_ns;
+  uint64_t     deadline;
+
+  // statistics
+  uint64_t steps;
+  uint64_t missed;
+  uint64_t dropped;
+};
+
+void         ticker_init(struct ticker * ticker, unsigned int rate,
+  enum ticker_catchup_t catchup, unsigned int max_steps);
+void         ticker_reset(struct ticker * ticker);
+void         ticker_set_rate(struct ticker * ticker, unsigned int rate);
+unsigned int ticker_advance(struct ticker * ticker);
+
+nanosecond_t ticker_now(void);
+nanosecond_t ticker_deadline_ns(const struct ticker * ticker);
+
+#endif // TICKER_H
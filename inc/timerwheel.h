@@ -0,0 +1,135 @@
+/**
+ * timerwheel.h
+ *
+ * tty-snake hashed timer wheel (timers counted in game updates).
+ *
+ * A timer due at tick t is kept in slot t % TIMER_WHEEL_SLOTS, in a list
+ * linked through a fixed pool of timers. Scheduling and cancelling a timer
+ * only link or unlink it, and advancing the wheel by a tick only looks at
+ * the timers in a single slot, however many timers are pending. Timers
+ * don't hold function pointers but a kind and an argument, which are handed
+ * to the wheel's fire function, so that they can be saved in snapshots.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+// slots in the wheel (must be a power of two). Timers further away than a
+// full turn of the wheel share slots with nearer ones
+#define TIMER_WHEEL_SLOTS 256
+
+// most timers that can be pending at once
+#define TIMER_WHEEL_MAX   16
+
+// handle of no timer (also ends the wheel's lists)
+#define TIMER_WHEEL_NONE  0xFFFFu
+
+#include <global.h>
+
+/**
+ * typedef:  timer_fire_fn
+ * -----------------------
+ * called when a timer fires (the timer is free again by then, so it can be
+ * scheduled again from here).
+ *
+ * ctx:   context given to timer_wheel_init
+ * kind:  the timer's kind
+ * arg:   the timer's argument
+ */
+typedef void (*timer_fire_fn)(void * ctx, unsigned int kind, uint32_t arg);
+
+/**
+ * enum:  timer_state_t
+ * --------------------
+ * TIMER_FREE:       in the free list
+ * TIMER_SCHEDULED:  in its slot's list, waiting for its deadline
+ * TIMER_DUE:        taken off its slot's list to fire on this tick
+ */
+enum timer_state_t
+{
+  TIMER_FREE = 0,
+  TIMER_SCHEDULED,
+  TIMER_DUE
+};
+
+/**
+ * struct:  timer_wheel_entry
+ * --------------------------
+ * a pending timer, as saved by timer_wheel_save.
+ *
+ * deadline:  tick the timer fires on
+ * kind:      what the timer does (see timer_fire_fn)
+ * arg:       argument for the fire function
+ */
+struct timer_wheel_entry
+{
+  uint64_t deadline;
+  uint32_t kind;
+  uint32_t arg;
+};
+
+/**
+ * struct:  timer_wheel_timer
+ * --------------------------
+ * deadline:  tick the timer fires on
+ * kind:      what the timer does (see timer_fire_fn)
+ * arg:       argument for the fire function
+ * next:      next timer in the slot's (or free) list
+ * prev:      previous timer in the slot's list
+ * state:     see enum timer_state_t
+ */
+struct timer_wheel_timer
+{
+  uint64_t deadline;
+  uint32_t kind;
+  uint32_t arg;
+  uint16_t next;
+  uint16_t prev;
+  uint8_t  state;
+};
+
+/**
+ * struct:  timer_wheel
+ * --------------------
+ * now:       ticks the wheel has advanced by
+ * is_paused: whether advancing the wheel is ignored
+ * count:     number of timers scheduled
+ * free_head: first free timer
+ * slots:     first timer of every slot's list
+ * timers:    the timer pool (a timer's handle is its index)
+ * fire:      called for every timer that fires
+ * ctx:       passed to fire
+ */
+struct timer_wheel
+{
+  uint64_t     now;
+  bool         is_paused;
+  unsigned int count;
+  uint16_t     free_head;
+  uint16_t     slots[TIMER_WHEEL_SLOTS];
+
+  struct timer_wheel_timer timers[TIMER_WHEEL_MAX];
+
+  timer_fire_fn fire;
+  void        * ctx;
+};
+
+// function declarations
+void     timer_wheel_init(struct timer_wheel * wheel, timer_fire_fn fire,
+           void * ctx);
+bool     timer_wheel_schedule(struct timer_wheel * wheel, unsigned int ticks,
+           unsigned int kind, uint32_t arg, unsigned int * handle);
+void     timer_wheel_cancel(struct timer_wheel * wheel, unsigned int handle);
+uint64_t timer_wheel_remaining(const struct timer_wheel * wheel,
+           unsigned int handle);
+void     timer_wheel_set_paused(struct timer_wheel * wheel, bool is_paused);
+void     timer_wheel_advance(struct timer_wheel * wheel);
+
+unsigned int timer_wheel_save(const struct timer_wheel * wheel,
+               struct timer_wheel_entry * entries);
+bool         timer_wheel_load(struct timer_wheel * wheel, uint64_t now,
+               const struct timer_wheel_entry * entries, unsigned int count);
+
+#endif // TIMERWHEEL_H
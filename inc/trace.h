@@ -0,0 +1,122 @@
+/**
+ * trace.h
+ *
+ * tty-snake event tracing, exported as Chrome trace-event JSON (loads in
+ * Perfetto and chrome://tracing).
+ *
+ * Every traced thread registers a ring of events once (trace_thread_start);
+ * recording an event then only writes into the calling thread's ring, which
+ * keeps the latest TRACE_RING_EVENTS events. Threads that didn't register
+ * (and every thread, if tracing is off) skip recording after a single
+ * check. Without USE_TRACE, the TRACE_* macros compile to nothing.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// events kept per thread (must be a power of two)
+#define TRACE_RING_EVENTS  65536
+
+// most threads that can be traced
+#define TRACE_MAX_THREADS  8
+
+#include <global.h>
+
+/**
+ * enum:  trace_event_t
+ * --------------------
+ * event types, as Chrome trace-event phases.
+ *
+ * TRACE_BEGIN:     a span begins
+ * TRACE_END:       the span that began last ends
+ * TRACE_COMPLETE:  a span with a known duration
+ * TRACE_INSTANT:   something happened
+ */
+enum trace_event_t
+{
+  TRACE_BEGIN    = 'B',
+  TRACE_END      = 'E',
+  TRACE_COMPLETE = 'X',
+  TRACE_INSTANT  = 'i'
+};
+
+/**
+ * struct:  trace_event
+ * --------------------
+ * time_ns: when the event (or span) happened (see get_time_ns)
+ * dur_ns:  duration of a TRACE_COMPLETE span
+ * name:    name of the event (must outlive the trace)
+ * detail:  optional detail (e.g. a gamestate's name, must outlive the trace)
+ * value:   optional value (e.g. a key)
+ * type:    see enum trace_event_t
+ */
+struct trace_event
+{
+  nanosecond_t       time_ns;
+  nanosecond_t       dur_ns;
+  const char       * name;
+  const char       * detail;
+  int64_t            value;
+  enum trace_event_t type;
+};
+
+/**
+ * struct:  trace_ring
+ * -------------------
+ * a thread's events. Only its thread writes it until the trace is written.
+ *
+ * thread_name: name the thread is shown with
+ * count:       number of events recorded (the ring holds the latest
+ *                TRACE_RING_EVENTS of them)
+ * events:      the ring
+ */
+struct trace_ring
+{
+  const char       * thread_name;
+  uint64_t           count;
+  struct trace_event events[TRACE_RING_EVENTS];
+};
+
+// the calling thread's ring (NULL if it isn't traced)
+extern _Thread_local struct trace_ring * trace_thread_ring;
+
+#ifdef USE_TRACE
+
+#define TRACE_BEGIN(name) \
+  do { if (trace_thread_ring) \
+    trace_record(TRACE_BEGIN, (name), get_time_ns(), 0, NULL, 0); } while (0)
+
+#define TRACE_END(name) \
+  do { if (trace_thread_ring) \
+    trace_record(TRACE_END, (name), get_time_ns(), 0, NULL, 0); } while (0)
+
+#define TRACE_COMPLETE(name,start_ns,dur_ns) \
+  do { if (trace_thread_ring) \
+    trace_record(TRACE_COMPLETE, (name), (start_ns), (dur_ns), NULL, 0); \
+  } while (0)
+
+#define TRACE_INSTANT(name,detail,value) \
+  do { if (trace_thread_ring) \
+    trace_record(TRACE_INSTANT, (name), get_time_ns(), 0, (detail), \
+      (value)); } while (0)
+
+bool trace_setup(void);
+void trace_thread_start(const char * thread_name);
+void trace_record(enum trace_event_t type, const char * name,
+  nanosecond_t time_ns, nanosecond_t dur_ns, const char * detail,
+  int64_t value);
+bool trace_write(const char * path);
+void trace_unset(void);
+
+#else
+
+#define TRACE_BEGIN(name)                    ((void) 0)
+#define TRACE_END(name)                      ((void) 0)
+#define TRACE_COMPLETE(name,start_ns,dur_ns) ((void) 0)
+#define TRACE_INSTANT(name,detail,value)     ((void) 0)
+
+#endif // USE_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,112 @@
+/**
+ * arena.c
+ *
+ * tty-snake memory arena (a single block that allocations are carved from).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <stdlib.h> // aligned_alloc(), free()
+
+#include <arena.h>
+
+
+/**
+ * function:  arena_setup
+ * ----------------------
+ * allocates an arena's block. Sum the ARENA_SIZE of every piece that will be
+ * carved from it to size it.
+ *
+ * arena: the arena to set up
+ * size:  size of the block in bytes
+ *
+ * returns: false if the block couldn't be allocated
+ */
+bool arena_setup(struct arena * arena, size_t size)
+{
+  arena->size = ARENA_SIZE(size);
+  arena->used = 0;
+  arena->base = aligned_alloc(ARENA_ALIGN, arena->size ? arena->size : 1);
+
+  return NULL != arena->base;
+}
+
+/**
+ * function:  arena_alloc
+ * ----------------------
+ * carves a piece from an arena. Never calls the allocator.
+ *
+ * arena: the arena
+ * size:  size of the piece in bytes
+ *
+ * returns: the piece (aligned to ARENA_ALIGN, not zeroed), or NULL if the
+ *            arena doesn't have room for it
+ */
+void * arena_alloc(struct arena * arena, size_t size)
+{
+  void * piece;
+
+  if (ARENA_SIZE(size) > arena->size - arena->used)
+    return NULL;
+
+  piece        = arena->base + arena->used;
+  arena->used += ARENA_SIZE(size);
+
+  return piece;
+}
+
+/**
+ * function:  arena_reset
+ * ----------------------
+ * gives back every piece carved from an arena at once (pieces carved after
+ * a reset reuse the same memory).
+ *
+ * arena: the arena
+ */
+void arena_reset(struct arena * arena)
+{
+  arena->used = 0;
+}
+
+/**
+ * function:  arena_mark
+ * ---------------------
+ * arena: the arena
+ *
+ * returns: a mark that arena_rewind can give back the pieces carved after
+ *            it with (e.g. scratch space)
+ */
+size_t arena_mark(const struct arena * arena)
+{
+  return arena->used;
+}
+
+/**
+ * function:  arena_rewind
+ * -----------------------
+ * gives back every piece carved from an arena since a mark.
+ *
+ * arena: the arena
+ * mark:  mark taken with arena_mark
+ */
+void arena_rewind(struct arena * arena, size_t mark)
+{
+  if (mark < arena->used)
+    arena->used = mark;
+}
+
+/**
+ * function:  arena_unset
+ * ----------------------
+ * frees an arena's block.
+ *
+ * arena: the arena
+ */
+void arena_unset(struct arena * arena)
+{
+  free(arena->base);
+
+  arena->base = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
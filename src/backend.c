@@ -0,0 +1,81 @@
+/**
+ * backend.c
+ *
+ * tty-snake renderer backend helpers (shared by every backend).
+ *
+ * Keys are read as raw bytes from stdin rather than through the terminal
+ * library, so that reading keys on the engine (or kb_listen) thread never
+ * touches state the render thread is drawing with.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <poll.h>   // poll(), POLLIN
+#include <unistd.h> // read()
+
+#include <backend.h>
+
+// bytes read from stdin that weren't returned as keys yet
+static unsigned char in_buf[16];
+static size_t        in_len = 0;
+
+
+/**
+ * function:  backend_read_stdin_key
+ * ---------------------------------
+ * reads a key from stdin, translating the arrow keys' escape sequences.
+ * Stdin is polled before it is read, so this never blocks, whatever the
+ * terminal's (or file's) mode.
+ *
+ * returns: the key, or ERR if there is none
+ */
+int backend_read_stdin_key(void)
+{
+  struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+  ssize_t       n;
+  int           key;
+
+  if (in_len < sizeof(in_buf) && poll(&pfd, 1, 0) > 0
+    && (pfd.revents & POLLIN))
+  {
+    n = read(STDIN_FILENO, in_buf + in_len, sizeof(in_buf) - in_len);
+
+    if (n > 0)
+      in_len += n;
+  }
+
+  if (0 == in_len)
+    return ERR;
+
+  key = in_buf[0];
+  n   = 1;
+
+  // ESC [ x and ESC O x (application cursor keys mode)
+  if (0x1b == in_buf[0] && in_len >= 3
+    && ('[' == in_buf[1] || 'O' == in_buf[1]))
+  {
+    switch (in_buf[2])
+    {
+      case 'A': key = KEY_UP;    n = 3; break;
+      case 'B': key = KEY_DOWN;  n = 3; break;
+      case 'C': key = KEY_RIGHT; n = 3; break;
+      case 'D': key = KEY_LEFT;  n = 3; break;
+    }
+  }
+
+  in_len -= n;
+  memmove(in_buf, in_buf + n, in_len);
+
+  return key;
+}
+
+/**
+ * function:  backend_reset_keys
+ * -----------------------------
+ * drops the bytes read from stdin that weren't returned as keys yet (when a
+ * backend gives the terminal back).
+ */
+void backend_reset_keys(void)
+{
+  in_len = 0;
+}
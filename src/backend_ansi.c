@@ -0,0 +1,413 @@
+/**
+ * backend_ansi.c
+ *
+ * tty-snake raw VT100/ANSI renderer backend.
+ *
+ * Every emitted cell is appended to a byte buffer allocated for the largest
+ * possible frame, and a flush hands the whole frame to the terminal with a
+ * single write(). The terminal's cursor position, attributes and character
+ * set are tracked, so cursor movements are skipped (or shortened) and
+ * attribute and charset changes are only sent when a cell actually needs
+ * different ones.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <errno.h>     // errno, EAGAIN, EINTR
+#include <fcntl.h>     // fcntl(), O_NONBLOCK
+#include <poll.h>      // poll(), POLLOUT
+#include <stdio.h>     // snprintf()
+#include <stdlib.h>    // malloc(), getenv()
+#include <sys/ioctl.h> // ioctl(), TIOCGWINSZ
+#include <termios.h>   // tcgetattr(), tcsetattr()
+#include <unistd.h>    // write()
+
+#include <backend.h>
+
+// most bytes a single cell can take (an absolute cursor movement, an SGR
+// sequence, a charset switch and the character)
+#define ANSI_CELL_MAX_BYTES 32
+
+// room for the sequences written outside of cells (setup, clear, unset)
+#define ANSI_EXTRA_BYTES    64
+
+// size used when the terminal can't be asked for it
+#define ANSI_DEFAULT_WIDTH  80
+#define ANSI_DEFAULT_HEIGHT 24
+
+#define ANSI_ESC "\x1b"
+
+// appends a string literal to the frame buffer
+#define ANSI_APPEND_LITERAL(s) ansi_append((s), sizeof(s) - 1)
+
+// private forward declarations
+static bool   ansi_setup(unsigned int *, unsigned int *);
+static bool   ansi_resize(unsigned int *, unsigned int *);
+static void   ansi_emit(unsigned int, unsigned int, scell_t);
+static size_t ansi_flush(void);
+static void   ansi_unset(void);
+
+static void   ansi_get_size(unsigned int *, unsigned int *);
+static bool   ansi_alloc(unsigned int, unsigned int);
+static void   ansi_append(const char *, size_t);
+static void   ansi_printf(const char *, unsigned int, unsigned int);
+static void   ansi_move(unsigned int, unsigned int);
+
+// external global variables
+const struct graphics_backend ansi_backend = { // backend.h
+  .name     = "ansi",
+  .setup    = ansi_setup,
+  .resize   = ansi_resize,
+  .emit     = ansi_emit,
+  .flush    = ansi_flush,
+  .read_key = backend_read_stdin_key,
+  .unset    = ansi_unset
+};
+
+// global variables
+static struct termios old_termios;
+static bool           is_termios_set  = false;
+static int            old_stdin_flags = -1;
+
+// frame buffer
+static char * out_buf = NULL;
+static size_t out_len = 0;
+static size_t out_cap = 0;
+
+// terminal state after the bytes in out_buf (cursor -1 if unknown)
+static unsigned int n_cols, n_rows;
+static int          cur_x = -1,
+                    cur_y = -1;
+static scell_t      cur_attr;
+static bool         is_dec_charset;
+
+
+/**
+ * function:  ansi_setup
+ * ---------------------
+ * puts the terminal into raw mode and switches to the alternate screen
+ * (see graphics_backend).
+ */
+static bool ansi_setup(unsigned int * width, unsigned int * height)
+{
+  struct termios raw_termios;
+
+  // no line buffering or echo, and reads return at once (signal keys such
+  // as Ctrl-C keep working)
+  if (0 == tcgetattr(STDIN_FILENO, &old_termios))
+  {
+    raw_termios = old_termios;
+    raw_termios.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+    raw_termios.c_iflag &= ~(IXON);
+    raw_termios.c_cc[VMIN]  = 0;
+    raw_termios.c_cc[VTIME] = 0;
+
+    is_termios_set = (0 == tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw_termios));
+  }
+
+  // stdin may not be a terminal, never block reading it
+  old_stdin_flags = fcntl(STDIN_FILENO, F_GETFL);
+
+  if (old_stdin_flags >= 0)
+    fcntl(STDIN_FILENO, F_SETFL, old_stdin_flags | O_NONBLOCK);
+
+  ansi_get_size(width, height);
+
+  if (!ansi_alloc(*width, *height))
+    return false;
+
+  // alternate screen, hidden cursor, default attributes and charset
+  ANSI_APPEND_LITERAL(ANSI_ESC "[?1049h" ANSI_ESC "[?25l" ANSI_ESC "[0m"
+    ANSI_ESC "(B" ANSI_ESC "[2J");
+
+  cur_x          = -1;
+  cur_y          = -1;
+  cur_attr       = SCELL_NORMAL;
+  is_dec_charset = false;
+
+  return true;
+}
+
+/**
+ * function:  ansi_resize
+ * ----------------------
+ * re-sizes the frame buffer to the terminal and clears it (see
+ * graphics_backend).
+ */
+static bool ansi_resize(unsigned int * width, unsigned int * height)
+{
+  ansi_get_size(width, height);
+
+  // drop the pending frame, it was meant for the old size
+  out_len = 0;
+
+  if (!ansi_alloc(*width, *height))
+    return false;
+
+  ANSI_APPEND_LITERAL(ANSI_ESC "[2J");
+
+  cur_x = -1;
+  cur_y = -1;
+
+  return true;
+}
+
+/**
+ * function:  ansi_emit
+ * --------------------
+ * appends a screen cell to the frame buffer (see graphics_backend).
+ */
+static void ansi_emit(unsigned int x, unsigned int y, scell_t cell)
+{
+  unsigned char ch   = SCELL_CH(cell);
+  scell_t       attr = SCELL_ATTR(cell);
+  char          dec_ch;
+
+  ansi_move(x, y);
+
+  // attributes are only changed when they differ
+  if (attr != cur_attr)
+  {
+    ANSI_APPEND_LITERAL(ANSI_ESC "[0");
+
+    if (attr & SCELL_BOLD)
+      ANSI_APPEND_LITERAL(";1");
+
+    if (attr & SCELL_STANDOUT)
+      ANSI_APPEND_LITERAL(";7");
+
+    ANSI_APPEND_LITERAL("m");
+
+    cur_attr = attr;
+  }
+
+  // line-drawing glyphs come from the DEC special graphics charset
+  switch (ch)
+  {
+    case GLYPH_HLINE:    dec_ch = 'q'; break;
+    case GLYPH_VLINE:    dec_ch = 'x'; break;
+    case GLYPH_ULCORNER: dec_ch = 'l'; break;
+    case GLYPH_URCORNER: dec_ch = 'k'; break;
+    case GLYPH_LLCORNER: dec_ch = 'm'; break;
+    case GLYPH_LRCORNER: dec_ch = 'j'; break;
+    default:             dec_ch = 0;   break;
+  }
+
+  if (dec_ch && !is_dec_charset)
+  {
+    ANSI_APPEND_LITERAL(ANSI_ESC "(0");
+    is_dec_charset = true;
+  }
+  else if (!dec_ch && is_dec_charset)
+  {
+    ANSI_APPEND_LITERAL(ANSI_ESC "(B");
+    is_dec_charset = false;
+  }
+
+  if (dec_ch)
+    ansi_append(&dec_ch, 1);
+  else
+    ansi_append((const char *) &ch, 1);
+
+  // after the last column, the terminal may or may not have wrapped yet
+  cur_x = (x + 1 < n_cols) ? (int) x + 1 : -1;
+}
+
+/**
+ * function:  ansi_flush
+ * ---------------------
+ * writes the frame buffer to the terminal, with a single write() unless the
+ * terminal only accepts part of it (see graphics_backend). On a terminal,
+ * stdout shares stdin's O_NONBLOCK, so a full output queue is waited out
+ * rather than dropping the rest of the frame (which the screen already
+ * counts as drawn).
+ *
+ * returns: the number of bytes written
+ */
+static size_t ansi_flush(void)
+{
+  size_t written = 0;
+
+  while (written < out_len)
+  {
+    ssize_t n = write(STDOUT_FILENO, out_buf + written, out_len - written);
+
+    if (n < 0 && EINTR == errno)
+      continue;
+
+    if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+      struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+
+      if (poll(&pfd, 1, -1) >= 0 || EINTR == errno)
+        continue;
+    }
+
+    // stdout is gone (or broken), nothing more can be shown
+    if (n <= 0)
+      break;
+
+    written += n;
+  }
+
+  out_len = 0;
+
+  return written;
+}
+
+/**
+ * function:  ansi_unset
+ * ---------------------
+ * restores the terminal (see graphics_backend).
+ */
+static void ansi_unset(void)
+{
+  // default attributes and charset, visible cursor, normal screen
+  ANSI_APPEND_LITERAL(ANSI_ESC "[0m" ANSI_ESC "(B" ANSI_ESC "[?25h"
+    ANSI_ESC "[?1049l");
+  ansi_flush();
+
+  if (is_termios_set)
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &old_termios);
+
+  if (old_stdin_flags >= 0)
+    fcntl(STDIN_FILENO, F_SETFL, old_stdin_flags);
+
+  is_termios_set  = false;
+  old_stdin_flags = -1;
+
+  backend_reset_keys();
+
+  free(out_buf);
+  out_buf = NULL;
+  out_cap = 0;
+}
+
+
+/**
+ * function:  ansi_get_size
+ * ------------------------
+ * asks the terminal for its size, falling back to $COLUMNS and $LINES and
+ * then to ANSI_DEFAULT_WIDTH x ANSI_DEFAULT_HEIGHT.
+ *
+ * width:   set to the number of columns
+ * height:  set to the number of rows
+ */
+static void ansi_get_size(unsigned int * width, unsigned int * height)
+{
+  struct winsize ws;
+  const char   * env;
+
+  if (0 == ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) && ws.ws_col && ws.ws_row)
+  {
+    *width  = ws.ws_col;
+    *height = ws.ws_row;
+    return;
+  }
+
+  env     = getenv("COLUMNS");
+  *width  = (env && atoi(env) > 0) ? (unsigned int) atoi(env)
+                                   : ANSI_DEFAULT_WIDTH;
+  env     = getenv("LINES");
+  *height = (env && atoi(env) > 0) ? (unsigned int) atoi(env)
+                                   : ANSI_DEFAULT_HEIGHT;
+}
+
+/**
+ * function:  ansi_alloc
+ * ---------------------
+ * sizes the frame buffer for a frame that changes every cell of a screen,
+ * so that drawing never has to allocate.
+ *
+ * width:   number of columns
+ * height:  number of rows
+ *
+ * returns: true on success
+ */
+static bool ansi_alloc(unsigned int width, unsigned int height)
+{
+  size_t cap = (size_t) width * height * ANSI_CELL_MAX_BYTES
+    + ANSI_EXTRA_BYTES;
+  char * buf = realloc(out_buf, cap);
+
+  if (!buf)
+    return false;
+
+  out_buf = buf;
+  out_cap = cap;
+  n_cols  = width;
+  n_rows  = height;
+
+  return true;
+}
+
+/**
+ * function:  ansi_append
+ * ----------------------
+ * appends bytes to the frame buffer.
+ *
+ * bytes: the bytes
+ * len:   number of bytes
+ */
+static void ansi_append(const char * bytes, size_t len)
+{
+  // can't happen with frames of the size the buffer was made for
+  if (out_len + len > out_cap)
+    ansi_flush();
+
+  memcpy(out_buf + out_len, bytes, len);
+  out_len += len;
+}
+
+/**
+ * function:  ansi_printf
+ * ----------------------
+ * appends an escape sequence holding up to two numbers to the frame buffer.
+ *
+ * format:  printf format of the sequence
+ * a:       first number
+ * b:       second number
+ */
+static void ansi_printf(const char * format, unsigned int a, unsigned int b)
+{
+  char seq[ANSI_CELL_MAX_BYTES];
+  int  len = snprintf(seq, sizeof(seq), format, a, b);
+
+  if (len > 0)
+    ansi_append(seq, len);
+}
+
+/**
+ * function:  ansi_move
+ * --------------------
+ * moves the cursor to a cell with the shortest sequence that does it, if it
+ * isn't there already.
+ *
+ * x: column (from 0)
+ * y: row (from 0)
+ */
+static void ansi_move(unsigned int x, unsigned int y)
+{
+  if ((int) y == cur_y && (int) x == cur_x)
+    return;
+
+  // same row, further right: cursor forward
+  if ((int) y == cur_y && cur_x >= 0 && (int) x > cur_x)
+  {
+    if (1 == x - cur_x)
+      ANSI_APPEND_LITERAL(ANSI_ESC "[C");
+    else
+      ansi_printf(ANSI_ESC "[%uC", x - cur_x, 0);
+  }
+  // same row: cursor to column
+  else if ((int) y == cur_y)
+    ansi_printf(ANSI_ESC "[%uG", x + 1, 0);
+  // start of the next row
+  else if (0 == x && cur_y >= 0 && (int) y == cur_y + 1)
+    ANSI_APPEND_LITERAL("\r\n");
+  else
+    ansi_printf(ANSI_ESC "[%u;%uH", y + 1, x + 1);
+
+  cur_x = x;
+  cur_y = y;
+}
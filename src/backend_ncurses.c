@@ -0,0 +1,139 @@
+/**
+ * backend_ncurses.c
+ *
+ * tty-snake ncurses renderer backend.
+ *
+ * ncurses isn't thread-safe, and keys are read on the engine thread while
+ * the render thread draws, so keys are read as raw bytes from stdin (see
+ * backend_read_stdin_key) and only the render thread ever calls ncurses.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <ncurses.h>
+#include <sys/ioctl.h> // ioctl(), TIOCGWINSZ
+#include <unistd.h>    // STDOUT_FILENO
+
+#include <backend.h>
+
+// global variables
+static int old_curs;
+
+// private forward declarations
+static bool   nc_setup(unsigned int *, unsigned int *);
+static bool   nc_resize(unsigned int *, unsigned int *);
+static void   nc_emit(unsigned int, unsigned int, scell_t);
+static size_t nc_flush(void);
+static void   nc_unset(void);
+
+// external global variables
+const struct graphics_backend ncurses_backend = { // backend.h
+  .name     = "ncurses",
+  .setup    = nc_setup,
+  .resize   = nc_resize,
+  .emit     = nc_emit,
+  .flush    = nc_flush,
+  .read_key = backend_read_stdin_key,
+  .unset    = nc_unset
+};
+
+
+/**
+ * function:  nc_setup
+ * -------------------
+ * initializes ncurses (see graphics_backend).
+ */
+static bool nc_setup(unsigned int * width, unsigned int * height)
+{
+  initscr();
+  raw();
+  keypad(stdscr, true);
+  noecho();
+  cbreak();
+  getmaxyx(stdscr, *height, *width);
+
+  old_curs = curs_set(0);
+
+  // ncurses never reads stdin, so it mustn't stop drawing to watch for keys
+  typeahead(-1);
+
+  return true;
+}
+
+/**
+ * function:  nc_resize
+ * --------------------
+ * resizes ncurses' screen to the terminal and clears it (see
+ * graphics_backend).
+ */
+static bool nc_resize(unsigned int * width, unsigned int * height)
+{
+  struct winsize ws;
+
+  if (0 == ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws))
+    resizeterm(ws.ws_row, ws.ws_col);
+
+  clear();
+
+  *width  = COLS;
+  *height = LINES;
+
+  return true;
+}
+
+/**
+ * function:  nc_emit
+ * ------------------
+ * writes a screen cell to the ncurses screen (see graphics_backend).
+ */
+static void nc_emit(unsigned int x, unsigned int y, scell_t cell)
+{
+  chtype ch;
+
+  switch (SCELL_CH(cell))
+  {
+    case GLYPH_HLINE:    ch = ACS_HLINE;    break;
+    case GLYPH_VLINE:    ch = ACS_VLINE;    break;
+    case GLYPH_ULCORNER: ch = ACS_ULCORNER; break;
+    case GLYPH_URCORNER: ch = ACS_URCORNER; break;
+    case GLYPH_LLCORNER: ch = ACS_LLCORNER; break;
+    case GLYPH_LRCORNER: ch = ACS_LRCORNER; break;
+    default:             ch = SCELL_CH(cell); break;
+  }
+
+  if (SCELL_ATTR(cell) & SCELL_BOLD)
+    ch |= A_BOLD;
+
+  if (SCELL_ATTR(cell) & SCELL_STANDOUT)
+    ch |= A_STANDOUT;
+
+  mvaddch(y, x, ch);
+}
+
+/**
+ * function:  nc_flush
+ * -------------------
+ * refreshes the terminal (see graphics_backend).
+ *
+ * returns: 0 (ncurses doesn't tell how much it wrote)
+ */
+static size_t nc_flush(void)
+{
+  refresh();
+
+  return 0;
+}
+
+/**
+ * function:  nc_unset
+ * -------------------
+ * uninitializes ncurses (see graphics_backend).
+ */
+static void nc_unset(void)
+{
+  refresh();
+  curs_set(old_curs);
+
+  endwin();
+  backend_reset_keys();
+}
@@ -6,46 +6,171 @@
  * See LICENSE for copyright information.
  */
 
-#ifdef DEBUG
-#include <stdio.h>
-#endif
-
-#include <ncurses.h> // getch()
-#include <pthread.h> // pthread_create()
+#include <errno.h>         // errno, EPERM
+#include <ncurses.h>       // ERR
+#include <pthread.h>       // pthread_create()
+#include <signal.h>        // sigaddset()
+#include <poll.h>          // poll()
+#include <stdatomic.h>     // atomic_fetch_or()
+#include <stdio.h>         // fprintf()
+#include <sys/epoll.h>     // epoll_wait()
+#include <sys/eventfd.h>   // eventfd()
+#include <sys/signalfd.h>  // signalfd()
+#include <sys/timerfd.h>   // timerfd_create()
+#include <unistd.h>        // read(), close()
 
+#include <frame.h>
 #include <game.h>
 #include <graphics.h>
+#include <hud.h>
+#include <keyring.h>
+#include <phase.h>
+#include <replay.h>
+#include <ticker.h>
+#include <trace.h>
 
 #include <engine.h>
 
 // external global variables
 bool is_engine_running;     // engine.h
 
-unsigned int game_x_bound;  // game.h
-unsigned int game_y_bound;
-struct ent_snake * snake;
-
 // global variables
-static bool do_tick; // whether the engine should keep running
+static struct game_ctx game;        // the game being played
+static bool            do_tick;     // whether the engine should keep running
+static bool            is_recording;
+static bool            is_replaying;
+static uint64_t        engine_tick; // number of ticks run so far
+static unsigned int    keyframe_interval; // ticks between keyframes
+
+// performance HUD (see HUD_KEY)
+static bool             is_hud_shown = false;
+static struct hud_meter tick_meter;  // game updates
+
+// reactor file descriptors
+static int      epoll_fd  = -1;
+static int      signal_fd = -1;  // SIGINT, SIGTERM, SIGWINCH
+static int      timer_fd  = -1;  // next tick's deadline
+static sigset_t prev_sigmask;    // signal mask before reactor_open
+static bool     is_sigmask_set = false;
+static bool     is_stdin_polled = false; // stdin can't be watched by epoll
 
 // private forward declarations
-static void input_gshandle_starting(int input_ch);
-static void input_gshandle_running(int input_ch);
-static void input_gshandle_paused(int input_ch);
-static void input_gshandle_ending(int input_ch);
+static void input_gshandle_starting(struct game_ctx * game, int input_ch);
+static void input_gshandle_running(struct game_ctx * game, int input_ch);
+static void input_gshandle_paused(struct game_ctx * game, int input_ch);
+static bool input_gshandle_ending(struct game_ctx * game, int input_ch);
+static unsigned int engine_sim_rate(const struct game_ctx * game);
+static bool engine_is_idle(void);
+static void engine_step(void);
+static void engine_keyframe(void);
+static void engine_key(int input_ch);
+static bool engine_read_keys(uint32_t events);
+static void engine_read_signals(void);
 static void _engine_stop(void);
+#ifdef USE_PHASE_STATS
+static void engine_report(FILE * out, const struct engine_config * config,
+  const struct ticker * sim_ticker, bool do_render);
+#endif
 
-#ifdef USE_KB_LISTEN_THREAD
-static int  last_ch; // most recently input key
+static bool reactor_open(bool watch_stdin);
+static void reactor_close(void);
+static void timer_arm(nanosecond_t deadline_ns);
+static void timer_clear(void);
+
+// requests for the render thread (besides drawing the latest frame)
+#define RENDER_REQ_RESIZE     0x1u
+#define RENDER_REQ_INVALIDATE 0x2u
+#define RENDER_REQ_STOP       0x4u
+
+// render thread variables
+static struct frame_exchange frames;              // frames to draw
+static atomic_uint           render_requests;     // RENDER_REQ_* flags
+static int                   render_wake_fd = -1; // wakes the thread
+static pthread_t             render_threadid;     // id from pthread_create
+
+static void render_wake(unsigned int requests);
+
+/**
+ * function:  render_loop
+ * ----------------------
+ * draws the latest published frame every time it is woken, until it is
+ * asked to stop. Only this thread touches the terminal's output, so a
+ * terminal that is slow to take a frame never delays the game.
+ *
+ * arg: unused argument (required by pthread_create)
+ *
+ * returns: NULL        (required by pthread_create)
+ */
+static void * render_loop(void * arg)
+{
+  const struct frame * frame;
+  eventfd_t            n_wakes;
+  unsigned int         requests;
+
+  (void) arg;
+
+#ifdef USE_TRACE
+  trace_thread_start("render");
+#endif
+
+  while (0 == eventfd_read(render_wake_fd, &n_wakes))
+  {
+    requests = atomic_exchange(&render_requests, 0);
+
+    if (requests & RENDER_REQ_STOP)
+      break;
+
+    if (requests & RENDER_REQ_RESIZE)
+      graphics_resize();
+
+    if (requests & RENDER_REQ_INVALIDATE)
+      graphics_invalidate();
+
+    // frames published while the last one was drawn were replaced by the
+    // latest one, so only that one is drawn
+    frame = frame_exchange_latest(&frames);
+
+    if (frame)
+    {
+      PHASE_START();
+      graphics_update(frame);
+      PHASE_STOP(PHASE_RENDER);
+    }
+  }
+
+  pthread_exit(NULL);
+}
+
+/**
+ * function:  render_wake
+ * ----------------------
+ * wakes the render thread to draw the latest frame. Never blocks.
+ *
+ * requests:  RENDER_REQ_* flags for the thread to handle first
+ */
+static void render_wake(unsigned int requests)
+{
+  if (render_wake_fd < 0)
+    return;
+
+  atomic_fetch_or(&render_requests, requests);
+  eventfd_write(render_wake_fd, 1);
+}
 
+#ifdef USE_KB_LISTEN_THREAD
 // kb_listen thread variables
-static bool      do_kb_listen = true; // 
-static pthread_t kb_listen_threadid;  // id from pthread_create
+static struct keyring kb_ring;           // keys read by the thread
+static int            kb_wake_fd = -1;   // wakes the reactor after a push
+static int            kb_stop_fd = -1;   // wakes the thread to exit
+static pthread_t      kb_listen_threadid; // id from pthread_create
+
+static bool engine_read_kb_ring(void);
 
 /**
  * function:  kb_listen
  * --------------------
- * actively listens for keyboard input while updating last_ch.
+ * waits for keyboard input, pushing every key read onto kb_ring and waking
+ * the reactor, until kb_stop_fd is signalled.
  *
  * arg: unused argument (required by pthread_create)
  *
@@ -53,17 +178,44 @@ static pthread_t kb_listen_threadid;  // id from pthread_create
  */
 static void * kb_listen(void * arg)
 {
-  while (do_kb_listen)
+  struct pollfd fds[] = {
+    { .fd = STDIN_FILENO, .events = POLLIN },
+    { .fd = kb_stop_fd,   .events = POLLIN }
+  };
+  struct key_event event;
+
+#ifdef USE_TRACE
+  trace_thread_start("kb_listen");
+#endif
+
+  while (poll(fds, 2, -1) >= 0 || EINTR == errno)
   {
-    last_ch = getch();
+    if (fds[1].revents)
+      break;
+
+    if (!fds[0].revents)
+      continue;
+
+    // graphics_getch() doesn't block, drain everything read so far
+    while (ERR != (event.ch = graphics_getch()))
+    {
+      keyring_push(&kb_ring, &event);
+      TRACE_INSTANT("key", NULL, event.ch);
+
+      #ifdef DEBUG
+      fprintf(stderr, "[kb_listen] ch = %d\n", event.ch);
+      #endif
+    }
+
+    eventfd_write(kb_wake_fd, 1);
 
-    #ifdef DEBUG
-    fprintf(stderr, "[kb_listen] last_ch = %d\n", last_ch);
-    #endif
+    // the terminal went away, stop polling it
+    if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL))
+      fds[0].fd = -1;
   }
 
   #ifdef DEBUG
-  fprintf(stderr, "[kb_listen] exiting\n");
+  fprintf(stderr, "[kb_listen] exiting (%u keys dropped)\n", kb_ring.dropped);
   #endif
 
   pthread_exit(NULL);
@@ -80,7 +232,7 @@ static void * kb_listen(void * arg)
  * ----------------------------------
  * TODO - documentation
  */
-static void input_gshandle_starting(int input_ch)
+static void input_gshandle_starting(struct game_ctx * game, int input_ch)
 {
   switch (input_ch)
   {
@@ -90,7 +242,7 @@ static void input_gshandle_starting(int input_ch)
 
     // any keypress advances the game
     default:
-      gamestate_set(GS_RUNNING);
+      gamestate_set(game, GS_RUNNING);
       break;
   }
 }
@@ -100,38 +252,38 @@ static void input_gshandle_starting(int input_ch)
  * ---------------------------------
  * TODO - documentation
  */
-static void input_gshandle_running(int input_ch)
+static void input_gshandle_running(struct game_ctx * game, int input_ch)
 {
   switch (input_ch)
   {
     case KEY_UP:
     case 'w':
-      snake_set_velocity(VEL_UP);
+      snake_queue_turn(game, VEL_UP);
       break;
 
     case KEY_RIGHT:
     case 'd':
-      snake_set_velocity(VEL_RIGHT);
+      snake_queue_turn(game, VEL_RIGHT);
       break;
 
     case KEY_DOWN:
     case 's':
-      snake_set_velocity(VEL_DOWN);
+      snake_queue_turn(game, VEL_DOWN);
       break;
 
     case KEY_LEFT:
     case 'a':
-      snake_set_velocity(VEL_LEFT);
+      snake_queue_turn(game, VEL_LEFT);
       break;
 
     // pause the game
     case PAUSE_KEY:
-      gamestate_set(GS_PAUSED);
+      gamestate_set(game, GS_PAUSED);
       break;
 
     // quit the game
     case QUIT_KEY:
-      gamestate_set(GS_ENDING);
+      gamestate_set(game, GS_ENDING);
       break;
   }
 }
@@ -141,18 +293,18 @@ static void input_gshandle_running(int input_ch)
  * --------------------------------
  * TODO - documentation
  */
-static void input_gshandle_paused(int input_ch)
+static void input_gshandle_paused(struct game_ctx * game, int input_ch)
 {
   switch (input_ch)
   {
     // unpause the game
     case PAUSE_KEY:
-      gamestate_set(GS_RUNNING);
+      gamestate_set(game, GS_RUNNING);
       break;
 
     // quit the game
     case QUIT_KEY:
-      gamestate_set(GS_ENDING);
+      gamestate_set(game, GS_ENDING);
       break;
   }
 }
@@ -160,110 +312,452 @@ static void input_gshandle_paused(int input_ch)
 /**
  * function:  input_gshandle_ending
  * --------------------------------
- * TODO - documentation
+ * handles keys on the game over screen: RESTART_KEY starts a new game, any
+ * other key stops the engine.
+ *
+ * returns: false if the engine should stop
  */
-static void input_gshandle_ending(int input_ch)
+static bool input_gshandle_ending(struct game_ctx * game, int input_ch)
 {
   switch (input_ch)
   {
     // on no input, do nothing
     case ERR:
-      break;
+      return true;
+
+    // start over on the same board (see game_restart)
+    case RESTART_KEY:
+      gamestate_set(game, GS_STARTING);
+      return true;
 
     // any keypress stops the game
     default:
-      do_tick = false;
-      break;
+      return false;
   }
 }
 
 
+/**
+ * function:  engine_handle_input
+ * ------------------------------
+ * passes a keypress to the input handler for the game's current state.
+ *
+ * game:      the game the key was pressed in
+ * input_ch:  the key that was pressed (ERR if none)
+ *
+ * returns: false if the key asks to stop playing (on the game over screen)
+ */
+bool engine_handle_input(struct game_ctx * game, int input_ch)
+{
+  switch (game->state)
+  {
+    case GS_STARTING:
+      input_gshandle_starting(game, input_ch);
+      break;
+
+    case GS_RUNNING:
+      input_gshandle_running(game, input_ch);
+      break;
+
+    case GS_PAUSED:
+      input_gshandle_paused(game, input_ch);
+      break;
+
+    case GS_ENDING:
+      return input_gshandle_ending(game, input_ch);
+  }
+
+  return true;
+}
+
 /**
  * function:  engine_start
  * -----------------------
  * starts the game engine.
+ *
+ * The engine is a reactor: it blocks in epoll_wait() until a key arrives on
+ * stdin, a signal arrives on the signalfd, or the timerfd reaches the next
+ * tick's deadline, and handles each of them as soon as it happens. Game
+ * updates (ticks) and frames run at independent rates: the tick rate follows
+ * the game's speed level, while a frame is only drawn when the screen is out
+ * of date, at most ENGINE_RENDER_RATE times per second. Frames are drawn by
+ * the render thread: the engine only captures a snapshot of the game and
+ * publishes it, which never waits for the terminal. While the game has
+ * nothing to update (see engine_is_idle), the timerfd is only armed to
+ * publish a stale frame, so an idle engine doesn't wake up at all. A stdin
+ * that can't be watched (a regular file or /dev/null) never blocks, so once
+ * polling it finds no keys left, an idle engine stops polling it too.
+ *
+ * config:  engine settings (recording and replay)
  */
-void engine_start(void)
+void engine_start(const struct engine_config * config)
 {
-  // convert (ticks per second) to (ns per tick)
-  const uint64_t MAX_ELAPSED_NS = (1 / (float)ENGINE_TICKRATE) * SECONDS;
+  struct replay_header header;
+  struct ticker        sim_ticker,    // game updates
+                       render_ticker, // frame cap
+                       input_ticker;  // stdin polls (if it can't be watched)
+  unsigned int x_bound = 0,
+               y_bound = 0;
+  bool   do_render,
+         do_throttle,
+         is_dirty = true,
+         is_idle,
+         is_stdin_drained = false; // the last stdin poll found no keys
+  nanosecond_t replay_start_ns;
+
+  is_replaying = (NULL != config->replay_path);
+  do_render    = !(is_replaying && config->replay_headless);
+  do_throttle  = !(is_replaying && config->replay_unthrottled);
+
+  // a replay reproduces the recorded session's randomizer and board
+  if (is_replaying)
+  {
+    if (!replay_play_open(config->replay_path, &header))
+    {
+      fprintf(stderr, "unable to read replay '%s'\n", config->replay_path);
+      return;
+    }
+  }
+
+  // block the signals the reactor handles (before any thread is started, so
+  // that every thread inherits the mask)
+  if (!reactor_open(do_render))
+  {
+    fprintf(stderr, "unable to set up the engine's event loop\n");
+    reactor_close();
+
+    if (is_replaying)
+      replay_play_close();
+
+    return;
+  }
 
   is_engine_running = true;
   do_tick           = true;
+  engine_tick       = 0;
+
+#ifdef USE_TRACE
+  // the engine's thread is traced from here, the others once they start
+  if (config->trace_path && trace_setup())
+    trace_thread_start("engine");
+#endif
 
   // setup modules
-  graphics_setup(); // does ncurses initialization
-  game_setup(game_x_bound / 2, game_y_bound / 2);
+  if (do_render)
+  {
+    // takes over the terminal
+    graphics_setup(config->backend, &x_bound, &y_bound);
+  }
+
+  if (is_replaying)
+  {
+    x_bound = header.x_bound;
+    y_bound = header.y_bound;
+  }
+
+  game_srand(&game, is_replaying ? header.seed : config->seed);
+  game_setup(&game, x_bound, y_bound, x_bound / 2, y_bound / 2);
+  game.turns.max_age = is_replaying
+    ? header.turn_max_age : config->turn_max_age;
+
+  // jump to the keyframe before the seek target (the ticks in between are
+  // simulated without rendering); without an index, simulate from the start
+  keyframe_interval = is_replaying
+    ? header.keyframe_interval : REPLAY_KEYFRAME_INTERVAL;
+
+  if (is_replaying && config->replay_seek_tick > 0)
+  {
+    uint64_t keyframe_tick;
+
+    if (replay_play_seek(&game, config->replay_seek_tick, &keyframe_tick))
+      engine_tick = keyframe_tick;
+  }
+
+  if (config->record_path)
+  {
+    header = (struct replay_header) {
+      .seed              = config->seed,
+      .x_bound           = x_bound,
+      .y_bound           = y_bound,
+      .keyframe_interval = keyframe_interval,
+      .turn_max_age      = game.turns.max_age
+    };
+
+    is_recording = replay_record_open(&game, config->record_path, &header);
+  }
+
+  engine_keyframe();
+
+#ifdef USE_PHASE_STATS
+  // a tick overruns when it takes longer than a tick, a frame when it takes
+  // longer than a frame
+  phase_reset();
+  PHASE_SET_BUDGET(PHASE_UPDATE, SECONDS / engine_sim_rate(&game));
+  PHASE_SET_BUDGET(PHASE_RENDER, SECONDS / ENGINE_RENDER_RATE);
+#endif
+
+  // start the render thread
+  if (do_render)
+  {
+    render_wake_fd = eventfd(0, EFD_CLOEXEC);
+
+    if (render_wake_fd < 0 || !frame_exchange_setup(&frames, x_bound, y_bound))
+      quit();
+
+    atomic_init(&render_requests, 0);
+    pthread_create(&render_threadid, NULL, render_loop, NULL);
+  }
 
 #ifdef USE_KB_LISTEN_THREAD
   // start keyboard listening thread
-  pthread_create(&kb_listen_threadid, NULL, kb_listen, NULL);
-#else
-  // set timeout so getch() is non-blocking
-  timeout(0);
+  if (do_render)
+  {
+    keyring_init(&kb_ring);
+    pthread_create(&kb_listen_threadid, NULL, kb_listen, NULL);
+  }
 #endif
 
+  ticker_init(&sim_ticker, engine_sim_rate(&game), config->catchup,
+    TICKER_DEFAULT_MAX_STEPS);
+  ticker_init(&render_ticker, ENGINE_RENDER_RATE, TICKER_CATCHUP_DROP, 1);
+  ticker_init(&input_ticker, ENGINE_INPUT_RATE, TICKER_CATCHUP_DROP, 1);
+
+  replay_start_ns = get_time_ns();
+  is_idle         = engine_is_idle();
+
   // engine tick
   while (do_tick)
   {
-    int          input_ch;
-    nanosecond_t start_ns, end_ns, elapsed_ns;
+    struct epoll_event events[ENGINE_MAX_EVENTS];
+    bool         is_seeking = (engine_tick < config->replay_seek_tick),
+                 do_wait    = (do_throttle && !is_seeking);
+    nanosecond_t wake_ns;
+    unsigned int steps;
+    int          n_events, i;
+
+    // sleep until the earliest of the next game update (unless idle), the
+    // next frame (if the screen is out of date) and the next stdin poll;
+    // fast-forwarding only checks for keys and signals
+    if (do_wait)
+    {
+      wake_ns = is_idle ? UINT64_MAX : ticker_deadline_ns(&sim_ticker);
+
+      if (do_render && is_dirty
+        && ticker_deadline_ns(&render_ticker) < wake_ns)
+        wake_ns = ticker_deadline_ns(&render_ticker);
+
+      if (is_stdin_polled && !(is_idle && is_stdin_drained)
+        && ticker_deadline_ns(&input_ticker) < wake_ns)
+        wake_ns = ticker_deadline_ns(&input_ticker);
 
-    start_ns = get_time_ns();
+      // with no deadline at all, only an event wakes the engine
+      timer_arm((UINT64_MAX != wake_ns) ? wake_ns : 0);
+    }
+
+    PHASE_START();
+    n_events = epoll_wait(epoll_fd, events, ENGINE_MAX_EVENTS,
+      do_wait ? -1 : 0);
+    PHASE_STOP(PHASE_WAIT);
 
-    // check for keyboard input
+    for (i = 0; i < n_events; i++)
+    {
+      if (signal_fd == events[i].data.fd)
+        engine_read_signals();
+      else if (STDIN_FILENO == events[i].data.fd)
+        is_dirty |= engine_read_keys(events[i].events);
+      else if (timer_fd == events[i].data.fd)
+        timer_clear();
 #ifdef USE_KB_LISTEN_THREAD
-    input_ch = last_ch;
-#else
-    input_ch = getch();
+      else if (kb_wake_fd == events[i].data.fd)
+        is_dirty |= engine_read_kb_ring();
 #endif
+    }
+
+    if (is_stdin_polled && ticker_advance(&input_ticker))
+    {
+      is_stdin_drained = !engine_read_keys(0);
+      is_dirty        |= !is_stdin_drained;
+    }
+
+    PHASE_STOP(PHASE_INPUT);
+
+    if (!do_tick)
+      break;
+
+    // the game entered or left an idle state (by a key, or by the game
+    // ending on the previous update)
+    if (is_idle != engine_is_idle())
+    {
+      is_idle = !is_idle;
+
+      // deadlines that passed while idle weren't missed
+      if (!is_idle)
+        ticker_reset(&sim_ticker);
+
+      // the HUD's tick rate restarts from 0
+      if (is_hud_shown)
+      {
+        hud_meter_reset(&tick_meter, get_time_ns());
+        is_dirty = true;
+      }
+    }
+
+    // after an overrun the ticker decides how many ticks to run at once
+    if (is_seeking)
+      steps = (config->replay_seek_tick - engine_tick < ENGINE_FAST_FORWARD_TICKS)
+        ? config->replay_seek_tick - engine_tick
+        : ENGINE_FAST_FORWARD_TICKS;
+    else if (is_idle)
+      steps = 0;
+    else if (do_throttle)
+      steps = ticker_advance(&sim_ticker);
+    else
+      steps = do_render ? 1 : ENGINE_FAST_FORWARD_TICKS;
 
-    // handle input based on current state
-    switch (game_state)
+    for (; steps > 0 && do_tick; steps--)
     {
-      case GS_STARTING:
-        input_gshandle_starting(input_ch);
-        break;
+      nanosecond_t step_start_ns = is_hud_shown ? get_time_ns() : 0;
 
-      case GS_RUNNING:
-        input_gshandle_running(input_ch);
-        break;
+      engine_step();
+      is_dirty = true;
 
-      case GS_PAUSED:
-        input_gshandle_paused(input_ch);
-        break;
+      PHASE_STOP(PHASE_UPDATE);
 
-      case GS_ENDING:
-        input_gshandle_ending(input_ch);
-        break;
+      if (is_hud_shown)
+        hud_meter_record(&tick_meter, get_time_ns() - step_start_ns, 0);
     }
 
-#ifdef USE_KB_LISTEN_THREAD
-    last_ch = -1;
-#endif
+    // the HUD's numbers change once per window (an idle engine has none to
+    // show, and doesn't wake up for them)
+    if (is_hud_shown && !is_idle)
+      is_dirty |= hud_meter_roll(&tick_meter, get_time_ns());
+
+    // the game speeds up as the snake grows
+    ticker_set_rate(&sim_ticker, engine_sim_rate(&game));
+    PHASE_SET_BUDGET(PHASE_UPDATE, SECONDS / engine_sim_rate(&game));
 
-    // update entities and re-draw
-    if (GS_ENDING != game_state)
-      game_update();
+    // fast-forward to the seek target without rendering or throttling
+    if (is_seeking)
+    {
+      if (engine_tick == config->replay_seek_tick)
+      {
+        if (do_render)
+          render_wake(RENDER_REQ_INVALIDATE);
 
-    graphics_update();
+        ticker_reset(&sim_ticker);
+      }
 
-    // limit engine tickrate
-    end_ns     = get_time_ns();
-    elapsed_ns = end_ns - start_ns;
+      continue;
+    }
 
-    // sleep if less than MAX_ELAPSED_NS ns have elapsed
-    if (elapsed_ns < MAX_ELAPSED_NS)
+    // hand a new frame to the render thread, at most ENGINE_RENDER_RATE
+    // times per second
+    if (do_render && do_tick && is_dirty && ticker_advance(&render_ticker))
     {
-      struct timespec sleep_ts;
+      struct frame * frame = frame_exchange_back(&frames);
+
+      PHASE_START();
+      frame_capture(frame, &game);
 
-      ns2timespec(MAX_ELAPSED_NS - elapsed_ns, &sleep_ts);
-      nanosleep(&sleep_ts, NULL);
+      frame->hud = (struct frame_hud) {
+        .is_shown    = is_hud_shown,
+        .tick_rate   = tick_meter.rate,
+        .tick_p99_ns = tick_meter.p99_ns
+      };
+
+      frame_exchange_publish(&frames);
+      render_wake(0);
+      PHASE_STOP(PHASE_PUBLISH);
+
+      is_dirty = false;
     }
   } // end of tick loop
 
+  if (is_replaying)
+  {
+    replay_play_close();
+
+    if (!do_render)
+    {
+      printf("replayed %llu ticks in %.3f ms (score: %u)\n",
+        (unsigned long long) engine_tick,
+        (double) (get_time_ns() - replay_start_ns) / MILLISECONDS,
+        game.score);
+    }
+  }
+
   _engine_stop();
+
+#ifdef USE_PHASE_STATS
+  // the render thread is gone, so every phase's timings (and the terminal's
+  // output statistics) are final
+  if (config->phase_stats_path)
+  {
+    FILE * stats_file = fopen(config->phase_stats_path, "w");
+
+    if (stats_file)
+    {
+      engine_report(stats_file, config, &sim_ticker, do_render);
+      fclose(stats_file);
+    }
+    else
+    {
+      fprintf(stderr, "unable to write phase timings to '%s'\n",
+        config->phase_stats_path);
+    }
+  }
+  else
+  {
+    engine_report(stderr, config, &sim_ticker, do_render);
+  }
+#endif
+
+#ifdef USE_TRACE
+  // the other traced threads are gone, so every ring is final
+  if (config->trace_path)
+  {
+    if (!trace_write(config->trace_path))
+      fprintf(stderr, "unable to write trace to '%s'\n", config->trace_path);
+
+    trace_unset();
+  }
+#endif
+}
+
+#ifdef USE_PHASE_STATS
+/**
+ * function:  engine_report
+ * ------------------------
+ * prints the phase timings and, if the session was drawn, the terminal's
+ * output statistics.
+ *
+ * out:        where to print the report
+ * config:     engine settings (selects the backend)
+ * sim_ticker: the game update ticker (for its missed deadlines)
+ * do_render:  whether the session was drawn
+ */
+static void engine_report(FILE * out, const struct engine_config * config,
+  const struct ticker * sim_ticker, bool do_render)
+{
+  struct graphics_stats stats;
+
+  phase_report(out, sim_ticker->missed, sim_ticker->dropped);
+
+  if (!do_render)
+    return;
+
+  graphics_get_stats(&stats);
+
+  fprintf(out, "[graphics] %s: %llu frames (%llu published), "
+    "%llu flushed, %llu cells, %llu bytes\n",
+    graphics_backend_to_string(config->backend),
+    (unsigned long long) stats.frames,
+    (unsigned long long) frames.published,
+    (unsigned long long) stats.flushes,
+    (unsigned long long) stats.cells,
+    (unsigned long long) stats.bytes);
 }
+#endif // USE_PHASE_STATS
 
 /**
  * function:  engine_stop
@@ -276,6 +770,202 @@ void engine_stop(void)
   do_tick = false;
 }
 
+/**
+ * function:  engine_sim_rate
+ * --------------------------
+ * game:  the game being played
+ *
+ * returns: game updates per second at the game's current speed level
+ */
+static unsigned int engine_sim_rate(const struct game_ctx * game)
+{
+  return ENGINE_SIM_RATE + game_speed_level(game) * ENGINE_SIM_RATE_STEP;
+}
+
+/**
+ * function:  engine_is_idle
+ * -------------------------
+ * whether the engine has no game updates to run: a live game that isn't
+ * running (title screen, paused or over) only changes on a key. Replays keep
+ * stepping, since their keys come from the recording.
+ *
+ * returns: true if the engine should only wake up for events
+ */
+static bool engine_is_idle(void)
+{
+  return !is_replaying && GS_RUNNING != game.state;
+}
+
+/**
+ * function:  engine_step
+ * ----------------------
+ * runs a single engine tick: plays back the tick's recorded keys (when
+ * replaying) and updates the game.
+ */
+static void engine_step(void)
+{
+  int input_ch;
+
+  if (is_replaying)
+  {
+    if (replay_play_is_done(engine_tick))
+    {
+      do_tick = false;
+      return;
+    }
+
+    while (ERR != (input_ch = replay_play_input(engine_tick)))
+      if (!engine_handle_input(&game, input_ch))
+        do_tick = false;
+
+    // like a live key, a key that stops the engine ends the session at once
+    if (!do_tick)
+      return;
+  }
+
+  // update entities
+  if (GS_ENDING != game.state)
+    game_update(&game);
+
+  engine_tick++;
+
+  engine_keyframe();
+}
+
+/**
+ * function:  engine_keyframe
+ * --------------------------
+ * on every keyframe_interval-th tick, prepares the game for a snapshot (see
+ * game_snapshot_prepare) and records it as a keyframe. Playback prepares
+ * the game on the same ticks, so it stays in step with the recording.
+ * Keyframes hold the state before the keys of their tick are handled.
+ */
+static void engine_keyframe(void)
+{
+  if ((!is_recording && !is_replaying) || 0 != engine_tick % keyframe_interval)
+    return;
+
+  game_snapshot_prepare(&game);
+
+  if (is_recording)
+    replay_record_keyframe(&game, engine_tick);
+}
+
+/**
+ * function:  engine_key
+ * ---------------------
+ * handles a live keypress right away. It is recorded on the tick about to
+ * run, so that playback handles it before that tick's update as well.
+ *
+ * input_ch:  the key that was pressed
+ */
+static void engine_key(int input_ch)
+{
+  TRACE_INSTANT("key", NULL, input_ch);
+
+  // the HUD is the viewer's, not the game's: it isn't recorded and works
+  // while watching a replay
+  if (HUD_KEY == input_ch)
+  {
+    is_hud_shown = !is_hud_shown;
+
+    if (is_hud_shown)
+      hud_meter_reset(&tick_meter, get_time_ns());
+
+    return;
+  }
+
+  // live input can only abort a replay
+  if (is_replaying)
+  {
+    if (QUIT_KEY == input_ch)
+      do_tick = false;
+
+    return;
+  }
+
+  if (is_recording)
+    replay_record_input(engine_tick, input_ch);
+
+  if (!engine_handle_input(&game, input_ch))
+    do_tick = false;
+}
+
+/**
+ * function:  engine_read_keys
+ * ---------------------------
+ * handles every key waiting on stdin.
+ *
+ * events:  epoll events reported for stdin
+ *
+ * returns: true if a key was handled (the screen is out of date)
+ */
+static bool engine_read_keys(uint32_t events)
+{
+  bool is_dirty = false;
+  int  input_ch;
+
+  while (ERR != (input_ch = graphics_getch()))
+  {
+    engine_key(input_ch);
+    is_dirty = true;
+  }
+
+  // the terminal went away, nobody is left to play
+  if (!is_dirty && (events & (EPOLLHUP | EPOLLERR)))
+    do_tick = false;
+
+  return is_dirty;
+}
+
+#ifdef USE_KB_LISTEN_THREAD
+/**
+ * function:  engine_read_kb_ring
+ * ------------------------------
+ * handles every key the listener thread pushed onto kb_ring.
+ *
+ * returns: true if a key was handled (the screen is out of date)
+ */
+static bool engine_read_kb_ring(void)
+{
+  struct key_event event;
+  eventfd_t        count;
+  bool             is_dirty = false;
+
+  // re-arms the wakeup before draining, so a key pushed meanwhile wakes the
+  // reactor again
+  eventfd_read(kb_wake_fd, &count);
+
+  while (keyring_pop(&kb_ring, &event))
+  {
+    engine_key(event.ch);
+    is_dirty = true;
+  }
+
+  return is_dirty;
+}
+#endif // USE_KB_LISTEN_THREAD
+
+/**
+ * function:  engine_read_signals
+ * ------------------------------
+ * handles every signal waiting on the signalfd: SIGWINCH has the render
+ * thread resize the screen (and re-draw the latest frame), SIGINT and
+ * SIGTERM stop the engine.
+ */
+static void engine_read_signals(void)
+{
+  struct signalfd_siginfo info;
+
+  while (sizeof(info) == read(signal_fd, &info, sizeof(info)))
+  {
+    if (SIGWINCH == info.ssi_signo)
+      render_wake(RENDER_REQ_RESIZE);
+    else
+      do_tick = false;
+  }
+}
+
 /**
  * function:  _engine_stop
  * -----------------------
@@ -285,17 +975,188 @@ void engine_stop(void)
  */
 static void _engine_stop(void)
 {
+  if (is_recording)
+  {
+    replay_record_close(engine_tick);
+    is_recording = false;
+  }
+
+#ifdef USE_KB_LISTEN_THREAD
+  // kb listen thread only runs when there is a terminal
+  bool has_kb_listen_thread = is_graphics_setup;
+#endif
+
+  // stop the render thread before the graphics module goes away
+  if (render_wake_fd >= 0)
+  {
+    render_wake(RENDER_REQ_STOP);
+
+    pthread_join(render_threadid, NULL);
+    close(render_wake_fd);
+    render_wake_fd = -1;
+
+    frame_exchange_unset(&frames);
+  }
+
   // unset modules
   graphics_unset();
-  game_unset();
+  game_unset(&game);
 
 #ifdef USE_KB_LISTEN_THREAD
-  // signal and wait for kb listen thread to stop
-  do_kb_listen = false;
+  // wake the kb listen thread out of poll() and wait for it to stop
+  if (has_kb_listen_thread)
+  {
+    eventfd_write(kb_stop_fd, 1);
 
-  pthread_join(kb_listen_threadid, NULL);
+    pthread_join(kb_listen_threadid, NULL);
+  }
 #endif
 
+  // unblocks the signals again (after the threads that inherited the mask
+  // are gone)
+  reactor_close();
+
   is_engine_running = false;
 }
 
+
+/*
+ * reactor functions
+ */
+
+/**
+ * function:  reactor_open
+ * -----------------------
+ * blocks SIGINT, SIGTERM and SIGWINCH so that they are delivered to a
+ * signalfd instead, and creates the epoll instance watching the signalfd,
+ * the tick timerfd and (optionally) stdin.
+ *
+ * watch_stdin: whether to wait for keys on stdin
+ *
+ * returns: true on success
+ */
+static bool reactor_open(bool watch_stdin)
+{
+  struct epoll_event event = { .events = EPOLLIN };
+  sigset_t           mask;
+
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGWINCH);
+
+  pthread_sigmask(SIG_BLOCK, &mask, &prev_sigmask);
+  is_sigmask_set = true;
+
+
+  epoll_fd  = epoll_create1(EPOLL_CLOEXEC);
+  signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  timer_fd  = timerfd_create(TICKER_CLOCK_ID, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  if (epoll_fd < 0 || signal_fd < 0 || timer_fd < 0)
+    return false;
+
+  event.data.fd = signal_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event) < 0)
+    return false;
+
+  event.data.fd = timer_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) < 0)
+    return false;
+
+#ifdef USE_KB_LISTEN_THREAD
+  // the listener thread reads stdin instead, and wakes the reactor through
+  // kb_wake_fd
+  if (watch_stdin)
+  {
+    kb_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    kb_stop_fd = eventfd(0, EFD_CLOEXEC);
+
+    if (kb_wake_fd < 0 || kb_stop_fd < 0)
+      return false;
+
+    event.data.fd = kb_wake_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, kb_wake_fd, &event) < 0)
+      return false;
+  }
+
+  watch_stdin = false;
+#endif
+
+  // regular files and /dev/null are always readable and can't be watched,
+  // so they are read on every pass instead
+  event.data.fd = STDIN_FILENO;
+  if (watch_stdin && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) < 0)
+  {
+    if (EPERM != errno)
+      return false;
+
+    is_stdin_polled = true;
+  }
+
+  return true;
+}
+
+/**
+ * function:  reactor_close
+ * ------------------------
+ * closes the reactor's file descriptors and restores the signal mask.
+ */
+static void reactor_close(void)
+{
+  if (epoll_fd >= 0)
+    close(epoll_fd);
+
+  if (signal_fd >= 0)
+    close(signal_fd);
+
+  if (timer_fd >= 0)
+    close(timer_fd);
+
+  epoll_fd = signal_fd = timer_fd = -1;
+  is_stdin_polled = false;
+
+#ifdef USE_KB_LISTEN_THREAD
+  if (kb_wake_fd >= 0)
+    close(kb_wake_fd);
+
+  if (kb_stop_fd >= 0)
+    close(kb_stop_fd);
+
+  kb_wake_fd = kb_stop_fd = -1;
+#endif
+
+  if (is_sigmask_set)
+  {
+    pthread_sigmask(SIG_SETMASK, &prev_sigmask, NULL);
+    is_sigmask_set = false;
+  }
+}
+
+/**
+ * function:  timer_arm
+ * --------------------
+ * makes the timerfd fire once at an absolute time.
+ *
+ * deadline_ns: when to fire (on TICKER_CLOCK_ID), or 0 to disarm it
+ */
+static void timer_arm(nanosecond_t deadline_ns)
+{
+  struct itimerspec spec = { .it_interval = { 0, 0 } };
+
+  ns2timespec(deadline_ns, &spec.it_value);
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+/**
+ * function:  timer_clear
+ * ----------------------
+ * acknowledges the timerfd's expiration, so that it stops being readable.
+ */
+static void timer_clear(void)
+{
+  uint64_t expirations;
+
+  if (read(timer_fd, &expirations, sizeof(expirations)) < 0)
+    return;
+}
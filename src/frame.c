@@ -0,0 +1,191 @@
+/**
+ * frame.c
+ *
+ * tty-snake frame snapshots, and the lock-free triple buffer that hands them
+ * from the simulation thread to the render thread.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // memcpy()
+
+#include <frame.h>
+
+
+/*
+ * frame functions
+ */
+
+/**
+ * function:  frame_setup
+ * ----------------------
+ * allocates a frame for a board size.
+ *
+ * frame:   the frame
+ * x_bound: game area width (including the boundary)
+ * y_bound: game area height (including the boundary)
+ *
+ * returns: true on success
+ */
+bool frame_setup(struct frame * frame, unsigned int x_bound,
+  unsigned int y_bound)
+{
+  *frame = (struct frame) {
+    .state   = GS_STARTING,
+    .x_bound = x_bound,
+    .y_bound = y_bound,
+    .grid    = calloc((size_t) x_bound * y_bound, 1)
+  };
+
+  return (NULL != frame->grid || 0 == x_bound * y_bound);
+}
+
+/**
+ * function:  frame_capture
+ * ------------------------
+ * copies what a game shows into a frame. Doesn't allocate.
+ *
+ * frame: the frame (set up for the game's board size)
+ * game:  the game
+ */
+void frame_capture(struct frame * frame, const struct game_ctx * game)
+{
+  frame->state        = game->state;
+  frame->score        = game->score;
+  frame->won          = game->won;
+  frame->powerup      = game->snake.powerup;
+  frame->food_powerup = game->food.powerup;
+
+  frame->head   = SNAKE_HEAD(&game->snake);
+  frame->tail   = SNAKE_TAIL(&game->snake);
+  frame->length = game->snake.length;
+
+  memcpy(frame->grid, game->grid, (size_t) frame->x_bound * frame->y_bound);
+}
+
+/**
+ * function:  frame_unset
+ * ----------------------
+ * frees a frame.
+ *
+ * frame: the frame
+ */
+void frame_unset(struct frame * frame)
+{
+  free(frame->grid);
+  frame->grid = NULL;
+}
+
+
+/*
+ * frame exchange functions
+ */
+
+/**
+ * function:  frame_exchange_setup
+ * -------------------------------
+ * allocates an exchange's frames. Must not race with the other
+ * frame_exchange functions.
+ *
+ * exchange:  the exchange
+ * x_bound:   game area width (including the boundary)
+ * y_bound:   game area height (including the boundary)
+ *
+ * returns: true on success
+ */
+bool frame_exchange_setup(struct frame_exchange * exchange,
+  unsigned int x_bound, unsigned int y_bound)
+{
+  unsigned int i;
+  bool         is_setup = true;
+
+  for (i = 0; i < 3; i++)
+    is_setup &= frame_setup(&exchange->frames[i], x_bound, y_bound);
+
+  atomic_init(&exchange->latest, 1);
+  exchange->back      = 0;
+  exchange->front     = 2;
+  exchange->has_front = false;
+  exchange->published = 0;
+
+  if (!is_setup)
+    frame_exchange_unset(exchange);
+
+  return is_setup;
+}
+
+/**
+ * function:  frame_exchange_back
+ * ------------------------------
+ * Only the producer thread may call this.
+ *
+ * exchange:  the exchange
+ *
+ * returns: the frame to capture the next frame into
+ */
+struct frame * frame_exchange_back(struct frame_exchange * exchange)
+{
+  return &exchange->frames[exchange->back];
+}
+
+/**
+ * function:  frame_exchange_publish
+ * ---------------------------------
+ * makes the back frame the latest, replacing the previous latest frame if
+ * the consumer didn't take it yet. Only the producer thread may call this.
+ *
+ * exchange:  the exchange
+ */
+void frame_exchange_publish(struct frame_exchange * exchange)
+{
+  // releases the captured frame, acquires the frame the consumer let go of
+  unsigned int prev = atomic_exchange_explicit(&exchange->latest,
+    exchange->back | FRAME_EXCHANGE_FRESH, memory_order_acq_rel);
+
+  exchange->back = prev & ~FRAME_EXCHANGE_FRESH;
+  exchange->published++;
+}
+
+/**
+ * function:  frame_exchange_latest
+ * --------------------------------
+ * takes the latest published frame, if it is newer than the one taken last.
+ * Only the consumer thread may call this.
+ *
+ * exchange:  the exchange
+ *
+ * returns: the latest published frame (valid until the next call), or NULL
+ *            if none was published yet
+ */
+const struct frame * frame_exchange_latest(struct frame_exchange * exchange)
+{
+  if (atomic_load_explicit(&exchange->latest, memory_order_relaxed)
+    & FRAME_EXCHANGE_FRESH)
+  {
+    // releases the drawn frame, acquires the published one
+    unsigned int prev = atomic_exchange_explicit(&exchange->latest,
+      exchange->front, memory_order_acq_rel);
+
+    exchange->front     = prev & ~FRAME_EXCHANGE_FRESH;
+    exchange->has_front = true;
+  }
+
+  return exchange->has_front ? &exchange->frames[exchange->front] : NULL;
+}
+
+/**
+ * function:  frame_exchange_unset
+ * -------------------------------
+ * frees an exchange's frames. Must not race with the other frame_exchange
+ * functions.
+ *
+ * exchange:  the exchange
+ */
+void frame_exchange_unset(struct frame_exchange * exchange)
+{
+  unsigned int i;
+
+  for (i = 0; i < 3; i++)
+    frame_unset(&exchange->frames[i]);
+}
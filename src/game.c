@@ -6,32 +6,109 @@
  * See LICENSE for copyright information.
  */
 
-#include <stdlib.h> // malloc(), rand()
-
 #include <game.h>
+#include <trace.h>
 
 #include <ncurses.h>
 
-// external global variables
-enum gamestate_t game_state;
-unsigned int     game_score;
-struct ent_food  * food;
-struct ent_snake * snake;
+// index of the (x, y) cell in a game's occupancy grid
+#define CELL_INDEX(g,x,y) ((size_t) (y) * (g)->x_bound + (x))
+
+// whether (x, y) is inside a game's area boundary
+#define IS_INTERIOR(g,x,y) \
+  ((x) > 0 && (x) < (g)->x_bound - 1 && (y) > 0 && (y) < (g)->y_bound - 1)
+
+// bytes taken by the moves between a snapshot's segments (2 bits each)
+#define SNAPSHOT_MOVE_BYTES(length) (((length) + 2) / 4)
 
-// global variables
-static nanosecond_t powerup_durations[PU_COUNT];
-static nanosecond_t gs_begin_ns; // when the current gamestate began
-static unsigned int tick_count;
+/**
+ * struct:  game_snapshot
+ * ----------------------
+ * fixed-size part of a game snapshot (see game_snapshot_save). It is
+ * followed by the game's pending timers (timer_count struct
+ * timer_wheel_entry, see timer_wheel_save), then by the move (velocity -
+ * VEL_UP, 2 bits each, four to a byte) from each segment to the next, from
+ * head to tail. The free-cell index isn't stored (see
+ * game_snapshot_prepare), so a snapshot takes a few hundred bytes whatever
+ * the board size.
+ *
+ * rand_state:  the game's randomizer state
+ * timer_now:   tick the game's timers were at
+ * snake_head:  packed coordinates of the snake's head
+ */
+struct game_snapshot
+{
+  uint64_t rand_state[4];
+  uint64_t timer_now;
+
+  uint32_t x_bound;
+  uint32_t y_bound;
+
+  uint32_t tick_count;
+  uint32_t game_state;
+  uint32_t game_score;
+  uint32_t game_won;
+
+  uint32_t food_x;
+  uint32_t food_y;
+  uint32_t food_consumed;
+  int32_t  food_powerup;
+
+  uint32_t snake_head;
+  uint32_t snake_length;
+  uint32_t snake_velocity;
+  uint32_t snake_prev_velocity;
+  int32_t  snake_powerup;
+  uint32_t snake_powerups;
+  uint32_t timer_count;
+
+  uint32_t turn_count;
+  uint32_t turn_velocities[TURN_QUEUE_SIZE];
+  uint32_t turn_ticks[TURN_QUEUE_SIZE];
+};
+
+// velocity each velocity would backtrack into
+static const enum velocity_t opposite_velocity[] = {
+  [VEL_NONE]  = VEL_NONE,
+  [VEL_UP]    = VEL_DOWN,
+  [VEL_RIGHT] = VEL_LEFT,
+  [VEL_DOWN]  = VEL_UP,
+  [VEL_LEFT]  = VEL_RIGHT
+};
+
+// change in x and y of a movement in each velocity
+static const int velocity_dx[] = {
+  [VEL_NONE] = 0, [VEL_UP] = 0, [VEL_RIGHT] = 1, [VEL_DOWN] = 0, [VEL_LEFT] = -1
+};
+static const int velocity_dy[] = {
+  [VEL_NONE] = 0, [VEL_UP] = -1, [VEL_RIGHT] = 0, [VEL_DOWN] = 1, [VEL_LEFT] = 0
+};
 
 // private forward declarations
-static void food_spawn(bool);
+static void grid_init(struct game_ctx *);
+static void grid_reset(struct game_ctx *);
+static void grid_set(struct game_ctx *, size_t, enum cell_t);
+
+static void free_cells_init(struct game_ctx *);
+static void free_cells_reset(struct game_ctx *);
+static void free_cells_insert(struct game_ctx *, size_t);
+static void free_cells_remove(struct game_ctx *, size_t);
+
+static enum velocity_t snake_backtrack_velocity(const struct ent_snake *);
+static void turn_queue_apply(struct game_ctx *);
+
+static enum velocity_t snapshot_move(const unsigned char *, unsigned int);
 
 static bool gamestate_can_transition(enum gamestate_t, enum gamestate_t);
 
-static enum powerup_t rand_powerup(void);
-static void powerup_init(void);
-static void powerup_tick(struct game_updatecycle_info *, bool);
-static void powerup_activate(struct game_updatecycle_info *, enum powerup_t);
+static enum powerup_t rand_powerup(struct game_ctx *);
+static void powerup_init(struct game_ctx *);
+static void powerup_tick(struct game_ctx *, struct game_updatecycle_info *);
+static void powerup_activate(struct game_ctx *,
+  struct game_updatecycle_info *, enum powerup_t);
+static void powerup_expire(struct game_ctx *, enum powerup_t);
+
+static void game_timer_fire(void *, unsigned int, uint32_t);
 
 
 /*
@@ -41,48 +118,104 @@ static void powerup_activate(struct game_updatecycle_info *, enum powerup_t);
 /**
  * function:  game_setup
  * ---------------------
- * initializes game elements.
+ * initializes game elements. Everything sized by the board is carved from a
+ * single arena, allocated here once for the game's lifetime. The game's
+ * randomizer is left as seeded by game_srand. Quits on boards that fail
+ * GAME_BOUNDS_VALID.
  *
+ * game:    the game to set up
+ * x_bound: game area width (including the boundary)
+ * y_bound: game area height (including the boundary)
  * init_x:  initial x coordinate for the snake
  * init_y:  initial y coordinate for the snake
  */
-void game_setup(unsigned int init_x, unsigned int init_y)
+void game_setup(struct game_ctx * game, unsigned int x_bound,
+  unsigned int y_bound, unsigned int init_x, unsigned int init_y)
 {
-  // call other initialization functions
-  powerup_init();
+  size_t n_cells    = (size_t) x_bound * y_bound,
+         n_interior = (size_t) (x_bound - 2) * (y_bound - 2);
 
-  tick_count  = 0;
-  gs_begin_ns = get_time_ns();
-  game_state  = GS_STARTING;
-  game_score  = 0;
+  if (!GAME_BOUNDS_VALID(x_bound, y_bound))
+    quit();
 
-  food  = calloc(1, sizeof(struct ent_food));
-  snake = calloc(1, sizeof(struct ent_snake));
+  game->x_bound = x_bound;
+  game->y_bound = y_bound;
+  game->init_x  = init_x;
+  game->init_y  = init_y;
+
+  // settings (kept by restarts)
+  powerup_init(game);
+  game->turns.max_age = TURN_DEFAULT_MAX_AGE;
+
+  // room for the grid, the free-cell index and the snake's body, then
+  // scratch space for checking snapshots (see game_snapshot_load)
+  if (!arena_setup(&game->arena,
+    ARENA_SIZE(n_cells)
+    + ARENA_SIZE(n_interior * sizeof(unsigned int))
+    + ARENA_SIZE(n_cells * sizeof(unsigned int))
+    + ARENA_SIZE(n_cells * sizeof(coord_t))
+    + ARENA_SIZE(n_cells)))
+    quit();
 
-  // we don't calloc since we have to initialize them anyway
-  snake->head = malloc(sizeof(struct ent_snake_seg));
-  snake->tail = malloc(sizeof(struct ent_snake_seg));
+  game_restart(game);
+}
 
-  // check if allocations failed
-  if (!food || !snake || !snake->head || !snake->tail)
-    quit();
+/**
+ * function:  game_restart
+ * -----------------------
+ * starts a new game (in GS_STARTING) on a game that was set up. The game's
+ * arena is reset and carved up again rather than freed, so restarting never
+ * calls the allocator. Settings are kept, and the randomizer carries on
+ * from where it was.
+ *
+ * game: the game to restart
+ */
+void game_restart(struct game_ctx * game)
+{
+  struct ent_food  * food  = &game->food;
+  struct ent_snake * snake = &game->snake;
 
-  *snake->head = (struct ent_snake_seg) {
-    .dying = false,
-    .x     = init_x,
-    .y     = init_y,
-    .prev  = NULL,
-    .next  = NULL
-  };
+  // timers only run while the game does (pending ones are dropped)
+  timer_wheel_init(&game->timers, game_timer_fire, game);
+  timer_wheel_set_paused(&game->timers, true);
+
+  game->tick_count = 0;
+  game->state      = GS_STARTING;
+  game->score      = 0;
+  game->won        = false;
 
-  // randomly place initial food piece
-  food_spawn(false);
+  memset(food, 0, sizeof(struct ent_food));
+  memset(snake, 0, sizeof(struct ent_snake));
+
+  game->turns.count = 0;
+
+  arena_reset(&game->arena);
+
+  grid_init(game);
+  free_cells_init(game);
+
+  // snake body can never hold more segments than there are cells
+  snake->capacity = game->x_bound * game->y_bound;
+  snake->body     = arena_alloc(&game->arena,
+    snake->capacity * sizeof(coord_t));
+
+  if (!snake->body)
+    quit();
 
   // snake initially only one segment long
-  snake->tail    = snake->head;
-  snake->length  = 1;
+  snake->head       = 0;
+  snake->body[0]    = COORD_PACK(game->init_x, game->init_y);
+  snake->length     = 1;
+  snake->dying      = 0;
 
-  snake->powerup = PU_NONE;
+  grid_set(game, CELL_INDEX(game, game->init_x, game->init_y), CELL_SNAKE);
+
+  snake->powerup  = PU_NONE;
+  snake->powerups = 0;
+
+  // randomly place initial food piece (there is no food to replace yet)
+  food->consumed = true;
+  food_spawn(game, false);
 }
 
 /**
@@ -90,14 +223,17 @@ void game_setup(unsigned int init_x, unsigned int init_y)
  * ----------------------
  * TODO - Documentation
  */
-bool game_update(void)
+bool game_update(struct game_ctx * game)
 {
+  struct ent_food  * food  = &game->food;
+  struct ent_snake * snake = &game->snake;
+
   bool   is_colliding = false,
          should_grow  = false;
-  struct ent_snake_seg * new_seg;
+  unsigned int head_x, head_y;
+  size_t       head_idx;
 
   struct game_updatecycle_info uc_info = {
-    .start_ns           = get_time_ns(),
     .snake_dx           = 0,
     .snake_dy           = 0,
     .snake_can_grow     = true,
@@ -105,23 +241,22 @@ bool game_update(void)
     .snake_new_velocity = snake->velocity // initially unchanging
   };
 
-  tick_count++;
+  game->tick_count++;
 
-  // free dying segments and remove from snake
-  while (snake->tail && snake->tail->dying)
-  {
-    struct ent_snake_seg * old_tail = snake->tail;
+  // dying segments have been erased by now, drop them from the ring buffer
+  snake->dying = 0;
 
-    snake->tail = snake->tail->prev;
-    snake->tail->next = NULL;
+  if (GS_RUNNING == game->state)
+  {
+    // apply the oldest queued direction change before moving
+    turn_queue_apply(game);
 
-    free(old_tail);
-  }
+    // fire the timers due on this update (e.g. expire powerups)
+    timer_wheel_advance(&game->timers);
+    uc_info.snake_new_velocity = snake->velocity;
 
-  if (GS_RUNNING == game_state)
-  {
-    // update uc_info based on powerup, if one is active
-    powerup_tick(&uc_info, true);
+    // update uc_info based on the active powerups
+    powerup_tick(game, &uc_info);
 
     // update head if snake is moving
     if (snake->velocity != VEL_NONE)
@@ -149,83 +284,65 @@ bool game_update(void)
         }
       }
 
-      // set up new_seg
-      new_seg = malloc(sizeof(struct ent_snake_seg));
-
-      // check if allocation failed
-      if (!new_seg)
-        quit(); // TODO maybe use a diff function if quit() doesnt behave
+      head_x   = COORD_X(SNAKE_HEAD(snake)) + uc_info.snake_dx;
+      head_y   = COORD_Y(SNAKE_HEAD(snake)) + uc_info.snake_dy;
+      head_idx = CELL_INDEX(game, head_x, head_y);
 
-      *new_seg = (struct ent_snake_seg) {
-        .dying = false,
-        .x = snake->head->x + uc_info.snake_dx,
-        .y = snake->head->y + uc_info.snake_dy,
-        .prev  = NULL,
-        .next  = snake->head
-      };
-
-      snake->head->prev = new_seg;
-      snake->head = new_seg;
+      // push new head into the slot before the current head
+      snake->head = (snake->head ? snake->head : snake->capacity) - 1;
+      snake->body[snake->head] = COORD_PACK(head_x, head_y);
       snake->length++;
 
       // check if snake consumed food
-      if (!food->consumed && ARE_COLLIDING(food, snake->head))
+      if (CELL_FOOD == game->grid[head_idx])
       {
         should_grow    = true;
         food->consumed = true;
 
         // absorb food's powerup
         if (PU_NONE != food->powerup)
-          powerup_activate(&uc_info, food->powerup);
+          powerup_activate(game, &uc_info, food->powerup);
 
         // XXX for now, score updates whenever food is consumed
-        game_score += 1 + snake->length;
-
-        // don't allow powerups to spawn if one is already active
-        food_spawn(PU_NONE == snake->powerup);
+        game->score += 1 + snake->length;
       }
 
       // pop tail and mark dying if snake is not growing
       if (!uc_info.snake_can_grow || !should_grow)
       {
-        snake->tail->dying = true;
+        grid_set(game, CELL_INDEX(game, COORD_X(SNAKE_TAIL(snake)),
+          COORD_Y(SNAKE_TAIL(snake))), CELL_EMPTY);
+
         snake->length--;
+        snake->dying++;
       }
 
-      // collision detection: ent_snake segments
-      if (snake->length > 1)
-      {
-        struct ent_snake_seg * check_seg = snake->head->next;
-
-        while (check_seg && !check_seg->dying)
-        {
-          if (ARE_COLLIDING(snake->head, check_seg))
-          {
-            is_colliding = true;
-            break;
-          }
-
-          check_seg = check_seg->next;
-        }
-      }
+      // collision detection: ent_snake segments and walls
+      is_colliding = (
+        CELL_SNAKE == game->grid[head_idx] || CELL_WALL == game->grid[head_idx]
+      );
 
-      // collision detection: walls
       if (!is_colliding)
+        grid_set(game, head_idx, CELL_SNAKE);
+
+      // replace consumed food once the head occupies its cell
+      // (don't allow powerups to spawn if one is already active)
+      // if there is no free cell left, the snake fills the board
+      if (!is_colliding && should_grow)
       {
-        is_colliding = (
-          snake->head->x <= 0 || snake->head->x >= game_x_bound - 1
-          || snake->head->y <= 0 || snake->head->y >= game_y_bound - 1
-        );
+        if (!food_spawn(game, 0 == snake->powerups))
+        {
+          game->won     = true;
+          is_colliding = true;
+        }
       }
 
       // update snake velocity (usually due to powerups)
-      snake_set_velocity(uc_info.snake_new_velocity);
+      snake_set_velocity(game, uc_info.snake_new_velocity);
 
-      // TODO other ways to lose / win?
-      // TODO game over: win or lose? can you only lose?
-      // check if game is over
+      // check if game is over (collided, or won by filling the board)
       if (is_colliding)
-        game_state = GS_ENDING;
+        gamestate_set(game, GS_ENDING);
     }
   }
 
@@ -235,26 +352,514 @@ bool game_update(void)
 /**
  * function:  game_unset
  * ---------------------
- * TODO - Documentation
+ * frees a game's arena (and with it everything carved from it).
+ */
+void game_unset(struct game_ctx * game)
+{
+  arena_unset(&game->arena);
+
+  game->snake.body = NULL;
+  game->grid       = NULL;
+  game->free_cells = NULL;
+  game->free_pos   = NULL;
+}
+
+/**
+ * function:  game_cell_at
+ * -----------------------
+ * looks up the contents of a board cell in the occupancy grid.
+ *
+ * game: the game to look in
+ * x:    x coordinate of the cell
+ * y:    y coordinate of the cell
+ *
+ * returns: what currently occupies the cell
+ */
+enum cell_t game_cell_at(const struct game_ctx * game,
+  unsigned int x, unsigned int y)
+{
+  return (enum cell_t) game->grid[CELL_INDEX(game, x, y)];
+}
+
+/**
+ * function:  game_speed_level
+ * ---------------------------
+ * the game speeds up as the snake grows, by one level every
+ * GAME_LEVEL_LENGTH segments (up to GAME_MAX_LEVEL). The engine updates the
+ * game faster on higher levels; the game itself always moves the snake once
+ * per update, so the level never changes what a replay's ticks do.
+ *
+ * game: the game
+ *
+ * returns: the current speed level, starting at 0
+ */
+unsigned int game_speed_level(const struct game_ctx * game)
+{
+  unsigned int level = (game->snake.length - 1) / GAME_LEVEL_LENGTH;
+
+  return (level < GAME_MAX_LEVEL) ? level : GAME_MAX_LEVEL;
+}
+
+/**
+ * function:  game_srand
+ * ---------------------
+ * seeds the game's randomizer. The game keeps its own randomizer state
+ * (instead of using rand()) so that it can be saved in snapshots, and so
+ * that games on different threads don't share it.
+ *
+ * game:  the game to seed
+ * seed:  the seed
+ */
+void game_srand(struct game_ctx * game, uint64_t seed)
+{
+  rng_seed(&game->rng, seed);
+}
+
+
+/*
+ * snapshot functions
+ */
+
+/**
+ * function:  game_snapshot_size
+ * -----------------------------
+ * returns: the most bytes game_snapshot_save can write for the current
+ *            board (with every timer pending and the board full of snake)
+ */
+size_t game_snapshot_size(const struct game_ctx * game)
+{
+  return sizeof(struct game_snapshot)
+    + TIMER_WHEEL_MAX * sizeof(struct timer_wheel_entry)
+    + SNAPSHOT_MOVE_BYTES((size_t) (game->x_bound - 2) * (game->y_bound - 2));
+}
+
+/**
+ * function:  game_snapshot_prepare
+ * --------------------------------
+ * puts the free-cell index in row-major order, the order game_snapshot_load
+ * rebuilds it in (snapshots don't store it). Since the index's order decides
+ * where food spawns, a game only plays on exactly like a copy restored from
+ * its snapshot if it was prepared before being saved, and a game that is
+ * compared against a recording must be prepared on the same ticks.
+ *
+ * game: the game to prepare
+ */
+void game_snapshot_prepare(struct game_ctx * game)
+{
+  free_cells_reset(game);
+}
+
+/**
+ * function:  game_snapshot_save
+ * -----------------------------
+ * saves the complete game state, so that it can later be restored with
+ * game_snapshot_load (see game_snapshot_prepare). The snapshot is in host
+ * byte order.
+ *
+ * game: the game to save
+ * buf:  buffer of at least game_snapshot_size() bytes
+ *
+ * returns: the number of bytes written
+ */
+size_t game_snapshot_save(const struct game_ctx * game, void * buf)
+{
+  const struct ent_food  * food  = &game->food;
+  const struct ent_snake * snake = &game->snake;
+
+  struct game_snapshot   * ss = buf;
+  struct timer_wheel_entry timers[TIMER_WHEEL_MAX];
+  unsigned char          * moves;
+  unsigned int             i;
+
+  *ss = (struct game_snapshot) {
+    .x_bound             = game->x_bound,
+    .y_bound             = game->y_bound,
+    .tick_count          = game->tick_count,
+    .game_state          = game->state,
+    .game_score          = game->score,
+    .game_won            = game->won,
+    .food_x              = food->x,
+    .food_y              = food->y,
+    .food_consumed       = food->consumed,
+    .food_powerup        = food->powerup,
+    .snake_head          = SNAKE_HEAD(snake),
+    .snake_length        = snake->length,
+    .snake_velocity      = snake->velocity,
+    .snake_prev_velocity = snake->prev_velocity,
+    .snake_powerup       = snake->powerup,
+    .snake_powerups      = snake->powerups,
+    .timer_now           = game->timers.now,
+    .turn_count          = game->turns.count
+  };
+
+  memcpy(ss->rand_state, game->rng.s, sizeof(ss->rand_state));
+
+  for (i = 0; i < TURN_QUEUE_SIZE; i++)
+  {
+    ss->turn_velocities[i] = (i < game->turns.count)
+      ? game->turns.velocities[i] : VEL_NONE;
+    ss->turn_ticks[i]      = (i < game->turns.count)
+      ? game->turns.ticks[i] : 0;
+  }
+
+  ss->timer_count = timer_wheel_save(&game->timers, timers);
+  memcpy(ss + 1, timers, ss->timer_count * sizeof(timers[0]));
+
+  // every segment is a single move away from the one before it
+  moves = (unsigned char *) (ss + 1) + ss->timer_count * sizeof(timers[0]);
+  memset(moves, 0, SNAPSHOT_MOVE_BYTES(snake->length));
+
+  for (i = 1; i < snake->length; i++)
+  {
+    coord_t         from = SNAKE_SEG(snake, i - 1),
+                    to   = SNAKE_SEG(snake, i);
+    enum velocity_t move;
+
+    if (COORD_X(to) != COORD_X(from))
+      move = (COORD_X(to) > COORD_X(from)) ? VEL_RIGHT : VEL_LEFT;
+    else
+      move = (COORD_Y(to) > COORD_Y(from)) ? VEL_DOWN : VEL_UP;
+
+    moves[(i - 1) / 4] |= (move - VEL_UP) << ((i - 1) % 4 * 2);
+  }
+
+  return (size_t) (moves - (unsigned char *) buf)
+    + SNAPSHOT_MOVE_BYTES(snake->length);
+}
+
+/**
+ * function:  game_snapshot_load
+ * -----------------------------
+ * restores the game state from a snapshot. The game must already be set up
+ * on a board of the snapshot's size. Snapshots come from files, so every
+ * field is checked before anything is restored: the game is left untouched
+ * if the snapshot is rejected.
+ *
+ * game:  the game to restore
+ * buf:   snapshot written by game_snapshot_save
+ * size:  size of the snapshot in bytes
+ *
+ * returns: true on success, false if the snapshot doesn't fit this game
+ */
+bool game_snapshot_load(struct game_ctx * game, const void * buf, size_t size)
+{
+  struct ent_food  * food  = &game->food;
+  struct ent_snake * snake = &game->snake;
+
+  struct game_snapshot     ss;
+  struct timer_wheel_entry timers[TIMER_WHEEL_MAX];
+  const unsigned char    * moves;
+  unsigned char          * marks;
+  unsigned int             i, x, y;
+  size_t                   idx,
+                           mark = arena_mark(&game->arena);
+  bool                     is_valid = true;
+
+  if (size < sizeof(ss))
+    return false;
+
+  memcpy(&ss, buf, sizeof(ss));
+
+  if (ss.x_bound != game->x_bound || ss.y_bound != game->y_bound
+    || 0 == ss.snake_length
+    || ss.snake_length > (size_t) (game->x_bound - 2) * (game->y_bound - 2)
+    || ss.timer_count > TIMER_WHEEL_MAX
+    || size != sizeof(ss) + ss.timer_count * sizeof(timers[0])
+      + SNAPSHOT_MOVE_BYTES(ss.snake_length)
+    || !IS_INTERIOR(game, ss.food_x, ss.food_y)
+    || ss.turn_count > TURN_QUEUE_SIZE)
+    return false;
+
+  memcpy(timers, (const unsigned char *) buf + sizeof(ss),
+    ss.timer_count * sizeof(timers[0]));
+  moves = (const unsigned char *) buf + sizeof(ss)
+    + ss.timer_count * sizeof(timers[0]);
+
+  // enums are used as indices, and the current powerup must be active
+  if (ss.game_state >= GS_COUNT
+    || ss.snake_velocity > VEL_LEFT || ss.snake_prev_velocity > VEL_LEFT
+    || ss.food_powerup < PU_NONE || ss.food_powerup >= PU_COUNT
+    || ss.snake_powerup < PU_NONE || ss.snake_powerup >= PU_COUNT
+    || ss.snake_powerups >= PU_BIT(PU_COUNT)
+    || (PU_NONE != ss.snake_powerup
+      && !(ss.snake_powerups & PU_BIT(ss.snake_powerup))))
+    return false;
+
+  for (i = 0; i < ss.turn_count; i++)
+  {
+    if (ss.turn_velocities[i] > VEL_LEFT)
+      return false;
+  }
+
+  // every timer must still be pending, and do something this game knows
+  for (i = 0; i < ss.timer_count; i++)
+  {
+    if (timers[i].deadline <= ss.timer_now
+      || timers[i].kind >= GAME_TIMER_COUNT
+      || (GAME_TIMER_POWERUP == timers[i].kind && timers[i].arg >= PU_COUNT))
+      return false;
+  }
+
+  // every segment must be inside the walls, and no two segments may share
+  // a cell (marked in scratch space)
+  marks = arena_alloc(&game->arena, (size_t) game->x_bound * game->y_bound);
+
+  if (!marks)
+    return false;
+
+  memset(marks, CELL_EMPTY, (size_t) game->x_bound * game->y_bound);
+
+  x = COORD_X(ss.snake_head);
+  y = COORD_Y(ss.snake_head);
+
+  for (i = 0; is_valid && i < ss.snake_length; i++)
+  {
+    if (i > 0)
+    {
+      x += velocity_dx[snapshot_move(moves, i)];
+      y += velocity_dy[snapshot_move(moves, i)];
+    }
+
+    is_valid = IS_INTERIOR(game, x, y)
+      && CELL_SNAKE != marks[CELL_INDEX(game, x, y)];
+
+    if (is_valid)
+      marks[CELL_INDEX(game, x, y)] = CELL_SNAKE;
+  }
+
+  // food can only lie on a free cell
+  if (is_valid && !ss.food_consumed
+    && CELL_SNAKE == marks[CELL_INDEX(game, ss.food_x, ss.food_y)])
+    is_valid = false;
+
+  arena_rewind(&game->arena, mark);
+
+  if (!is_valid)
+    return false;
+
+  game->tick_count = ss.tick_count;
+  game->state      = ss.game_state;
+  game->score      = ss.game_score;
+  game->won        = ss.game_won;
+
+  memcpy(game->rng.s, ss.rand_state, sizeof(game->rng.s));
+
+  // rebuild the snake and occupancy grid
+  grid_reset(game);
+
+  snake->head   = 0;
+  snake->length = ss.snake_length;
+  snake->dying  = 0;
+
+  x = COORD_X(ss.snake_head);
+  y = COORD_Y(ss.snake_head);
+
+  for (i = 0; i < snake->length; i++)
+  {
+    if (i > 0)
+    {
+      x += velocity_dx[snapshot_move(moves, i)];
+      y += velocity_dy[snapshot_move(moves, i)];
+    }
+
+    idx = CELL_INDEX(game, x, y);
+
+    snake->body[i]  = COORD_PACK(x, y);
+    game->grid[idx] = CELL_SNAKE;
+  }
+
+  // the free-cell index wasn't saved (see game_snapshot_prepare)
+  free_cells_reset(game);
+
+  snake->velocity          = ss.snake_velocity;
+  snake->prev_velocity     = ss.snake_prev_velocity;
+  snake->powerup           = ss.snake_powerup;
+  snake->powerups          = ss.snake_powerups;
+
+  // restore the timers (which get new handles), paused unless running
+  timer_wheel_set_paused(&game->timers, GS_RUNNING != game->state);
+  timer_wheel_load(&game->timers, ss.timer_now, timers, ss.timer_count);
+
+  for (i = 0; i < TIMER_WHEEL_MAX; i++)
+  {
+    const struct timer_wheel_timer * timer = &game->timers.timers[i];
+
+    if (TIMER_SCHEDULED == timer->state && GAME_TIMER_POWERUP == timer->kind
+      && timer->arg < PU_COUNT)
+      snake->powerup_timers[timer->arg] = i;
+  }
+
+  // the turn queue's max_age is a setting, not state, and is kept
+  game->turns.count = ss.turn_count;
+
+  for (i = 0; i < game->turns.count; i++)
+  {
+    game->turns.velocities[i] = ss.turn_velocities[i];
+    game->turns.ticks[i]      = ss.turn_ticks[i];
+  }
+
+  food->x        = ss.food_x;
+  food->y        = ss.food_y;
+  food->consumed = ss.food_consumed;
+  food->powerup  = ss.food_powerup;
+
+  if (!food->consumed)
+    game->grid[CELL_INDEX(game, food->x, food->y)] = CELL_FOOD;
+
+  return true;
+}
+
+/**
+ * function:  snapshot_move
+ * ------------------------
+ * moves:   the snapshot's packed moves
+ * i:       index of a segment, from 1 on
+ *
+ * returns: the move leading from segment i - 1 to segment i
+ */
+static enum velocity_t snapshot_move(const unsigned char * moves,
+  unsigned int i)
+{
+  return VEL_UP + ((moves[(i - 1) / 4] >> ((i - 1) % 4 * 2)) & 3);
+}
+
+
+/*
+ * occupancy grid functions
  */
-void game_unset(void)
+
+/**
+ * function:  grid_init
+ * --------------------
+ * carves the occupancy grid from the game's arena and marks the game area
+ * boundary as walls.
+ */
+static void grid_init(struct game_ctx * game)
+{
+  game->grid = arena_alloc(&game->arena,
+    (size_t) game->x_bound * game->y_bound);
+
+  if (!game->grid)
+    quit();
+
+  grid_reset(game);
+}
+
+/**
+ * function:  grid_reset
+ * ---------------------
+ * empties the occupancy grid, leaving only the walls.
+ */
+static void grid_reset(struct game_ctx * game)
 {
-  struct ent_snake_seg * next_seg = snake->head;
+  unsigned int x, y;
 
-  // free food if it exists
-  if (food)
-    free(food);
+  memset(game->grid, CELL_EMPTY, (size_t) game->x_bound * game->y_bound);
 
-  // free memory allocated with malloc
-  while (next_seg)
+  for (x = 0; x < game->x_bound; x++)
   {
-    struct ent_snake_seg * free_seg = next_seg;
-    next_seg = next_seg->next;
+    game->grid[CELL_INDEX(game, x, 0)]                 = CELL_WALL;
+    game->grid[CELL_INDEX(game, x, game->y_bound - 1)] = CELL_WALL;
+  }
 
-    free(free_seg);
+  for (y = 0; y < game->y_bound; y++)
+  {
+    game->grid[CELL_INDEX(game, 0, y)]                 = CELL_WALL;
+    game->grid[CELL_INDEX(game, game->x_bound - 1, y)] = CELL_WALL;
   }
+}
+
+/**
+ * function:  grid_set
+ * -------------------
+ * updates a cell in the occupancy grid, keeping the free-cell index in sync
+ * when a snake segment enters or leaves the cell.
+ *
+ * idx:   grid index of the cell
+ * cell:  the cell's new contents
+ */
+static void grid_set(struct game_ctx * game, size_t idx, enum cell_t cell)
+{
+  if (CELL_SNAKE == cell && CELL_SNAKE != game->grid[idx])
+    free_cells_remove(game, idx);
+  else if (CELL_SNAKE != cell && CELL_SNAKE == game->grid[idx])
+    free_cells_insert(game, idx);
+
+  game->grid[idx] = cell;
+}
+
+
+/*
+ * free-cell index functions
+ */
+
+/**
+ * function:  free_cells_init
+ * --------------------------
+ * carves the free-cell index from the game's arena and fills it with every
+ * interior cell.
+ */
+static void free_cells_init(struct game_ctx * game)
+{
+  game->free_cells = arena_alloc(&game->arena,
+    (size_t) (game->x_bound - 2) * (game->y_bound - 2) * sizeof(unsigned int)
+  );
+  game->free_pos   = arena_alloc(&game->arena,
+    (size_t) game->x_bound * game->y_bound * sizeof(unsigned int)
+  );
+
+  if (!game->free_cells || !game->free_pos)
+    quit();
+
+  free_cells_reset(game);
+}
+
+/**
+ * function:  free_cells_reset
+ * ---------------------------
+ * rebuilds the free-cell index from the occupancy grid: every interior cell
+ * the snake doesn't occupy, in row-major order.
+ */
+static void free_cells_reset(struct game_ctx * game)
+{
+  unsigned int x, y;
+
+  game->free_count = 0;
+
+  for (y = 1; y < game->y_bound - 1; y++)
+    for (x = 1; x < game->x_bound - 1; x++)
+      if (CELL_SNAKE != game->grid[CELL_INDEX(game, x, y)])
+        free_cells_insert(game, CELL_INDEX(game, x, y));
+}
+
+/**
+ * function:  free_cells_insert
+ * ----------------------------
+ * appends a cell to the free-cell index.
+ *
+ * idx: grid index of the cell that became free
+ */
+static void free_cells_insert(struct game_ctx * game, size_t idx)
+{
+  game->free_pos[idx]                  = game->free_count;
+  game->free_cells[game->free_count++] = idx;
+}
+
+/**
+ * function:  free_cells_remove
+ * ----------------------------
+ * removes a cell from the free-cell index by moving the last free cell into
+ * its slot.
+ *
+ * idx: grid index of the cell that became occupied
+ */
+static void free_cells_remove(struct game_ctx * game, size_t idx)
+{
+  unsigned int pos  = game->free_pos[idx];
+  unsigned int last = game->free_cells[--game->free_count];
 
-  free(snake);
+  game->free_cells[pos] = last;
+  game->free_pos[last]  = pos;
 }
 
 
@@ -272,31 +877,47 @@ void game_unset(void)
 /**
  * function:  food_spawn
  * ---------------------
- * randomly place a food bit (potentially with powerup) on the board.
+ * randomly place a food bit (potentially with powerup) on a free cell.
  *
+ * game:          the game to place the food in
  * allow_powerup: true if food can spawn with a powerup
+ *
+ * returns: true if the food was placed, false if no free cell is left
  */
-static void food_spawn(bool allow_powerup)
+bool food_spawn(struct game_ctx * game, bool allow_powerup)
 {
-  unsigned int rand_x, rand_y;
+  struct ent_food * food = &game->food;
+  unsigned int idx;
 
-  do
+  // remove food that is being replaced before it was consumed
+  if (!food->consumed)
   {
-    // rand seeded in ttysnake.c:main
-    rand_x = rand() % (game_x_bound - 2) + 1; // inside boundaries
-    rand_y = rand() % (game_y_bound - 2) + 1; // inside boundaries
-  } while (rand_x == snake->head->x && rand_y == snake->head->y);
+    game->grid[CELL_INDEX(game, food->x, food->y)] = CELL_EMPTY;
+    food->consumed = true;
+  }
+
+  if (0 == game->free_count)
+    return false;
+
+  idx = game->free_cells[rng_bounded(&game->rng, game->free_count)];
 
   food->powerup = PU_NONE;
 
   // rarely, spawn powerup (if allowed)
-  if (allow_powerup && (rand() % 100) <= PU_SPAWN_PERCENTAGE)
-    food->powerup = rand_powerup();
+  if (allow_powerup
+    && rng_bounded(&game->rng, 100) <= PU_SPAWN_PERCENTAGE)
+    food->powerup = rand_powerup(game);
 
-  food->x = rand_x;
-  food->y = rand_y;
+  food->x = idx % game->x_bound;
+  food->y = idx / game->x_bound;
 
   food->consumed = false;
+
+  game->grid[idx] = CELL_FOOD;
+
+  TRACE_INSTANT("food_spawn", powerup_to_string(food->powerup), idx);
+
+  return true;
 }
 
 
@@ -304,47 +925,166 @@ static void food_spawn(bool allow_powerup)
  * snake functions
  */
 
+/**
+ * function:  snake_grow
+ * ---------------------
+ * extends the snake with a new head segment on a free cell, without moving
+ * or checking for collisions. Used to build a snake of a given length (for
+ * example in benchmarks) without playing the game.
+ *
+ * game: the game whose snake grows
+ * x:    x coordinate of the new head (must be adjacent to the current head)
+ * y:    y coordinate of the new head
+ *
+ * returns: true if the segment was added, false if the cell is not free
+ */
+bool snake_grow(struct game_ctx * game, unsigned int x, unsigned int y)
+{
+  struct ent_food  * food  = &game->food;
+  struct ent_snake * snake = &game->snake;
+
+  size_t idx = CELL_INDEX(game, x, y);
+
+  if (CELL_EMPTY != game->grid[idx] && CELL_FOOD != game->grid[idx])
+    return false;
+
+  snake->head = (snake->head ? snake->head : snake->capacity) - 1;
+  snake->body[snake->head] = COORD_PACK(x, y);
+  snake->length++;
+
+  grid_set(game, idx, CELL_SNAKE);
+
+  // the food was eaten by the new head
+  if (!food->consumed && food->x == x && food->y == y)
+    food->consumed = true;
+
+  return true;
+}
+
 /**
  * function:  snake_set_velocity
  * -----------------------------
  * TODO - documetation
  */
-void snake_set_velocity(enum velocity_t velocity)
+void snake_set_velocity(struct game_ctx * game, enum velocity_t velocity)
 {
-  enum velocity_t opposite_velocity[5];
-  enum velocity_t illegal_velocity;
-
-  opposite_velocity[VEL_NONE]  = VEL_NONE;
-  opposite_velocity[VEL_UP]    = VEL_DOWN;
-  opposite_velocity[VEL_RIGHT] = VEL_LEFT;
-  opposite_velocity[VEL_DOWN]  = VEL_UP;
-  opposite_velocity[VEL_LEFT]  = VEL_RIGHT;
+  struct ent_snake * snake = &game->snake;
 
   // TODO if snake is only one unit long, is backtracking OK?
 
   // if not in GS_RUNNING, disallow velocity changes entirely
-  if (GS_RUNNING != game_state)
+  if (GS_RUNNING != game->state)
     return;
 
-  // disallow backtracking (180 deg velocity change)
+  // don't update velocity if unchanging or illegal
+  if (velocity != snake_backtrack_velocity(snake) && velocity != snake->velocity)
+  {
+    snake->prev_velocity = snake->velocity;
+    snake->velocity      = velocity;
+  }
+}
+
+/**
+ * function:  snake_queue_turn
+ * ---------------------------
+ * queues a direction change for the snake's next movement that doesn't
+ * have one yet. A turn that repeats or backtracks the direction the snake
+ * will have by then is collapsed (dropped), as is any turn beyond
+ * TURN_QUEUE_SIZE.
+ *
+ * game:      the game
+ * velocity:  the new direction
+ *
+ * returns: true if the turn was queued
+ */
+bool snake_queue_turn(struct game_ctx * game, enum velocity_t velocity)
+{
+  struct ent_snake  * snake = &game->snake;
+  struct turn_queue * turns = &game->turns;
+
+  enum velocity_t last_velocity, illegal_velocity;
+
+  // if not in GS_RUNNING, disallow velocity changes entirely
+  if (GS_RUNNING != game->state || VEL_NONE == velocity
+    || TURN_QUEUE_SIZE == turns->count)
+    return false;
+
+  // compare against the last queued turn, or the snake if there is none
+  if (turns->count > 0)
+  {
+    last_velocity    = turns->velocities[turns->count - 1];
+    illegal_velocity = opposite_velocity[last_velocity];
+  }
+  else
+  {
+    last_velocity    = snake->velocity;
+    illegal_velocity = snake_backtrack_velocity(snake);
+  }
+
+  if (velocity == last_velocity || velocity == illegal_velocity)
+    return false;
+
+  turns->velocities[turns->count] = velocity;
+  turns->ticks[turns->count]      = game->tick_count;
+  turns->count++;
+
+  return true;
+}
+
+/**
+ * function:  snake_backtrack_velocity
+ * -----------------------------------
+ * the velocity that would make the snake backtrack (180 deg velocity
+ * change) into itself.
+ *
+ * snake: the snake
+ *
+ * returns: the illegal velocity
+ */
+static enum velocity_t snake_backtrack_velocity(const struct ent_snake * snake)
+{
   switch (snake->velocity)
   {
     // likely in single-step mode, so check prev_velocity
     case VEL_NONE:
-      illegal_velocity = opposite_velocity[snake->prev_velocity];
-      break;
+      return opposite_velocity[snake->prev_velocity];
 
     // all other times, check current velocity
     default:
-      illegal_velocity = opposite_velocity[snake->velocity];
-      break;
+      return opposite_velocity[snake->velocity];
   }
+}
 
-  // don't update velocity if unchanging or illegal
-  if (velocity != illegal_velocity && velocity != snake->velocity)
+/**
+ * function:  turn_queue_apply
+ * ---------------------------
+ * drops the queued turns that have gone stale, then applies the oldest
+ * remaining one to the snake.
+ *
+ * game:  the game about to move its snake
+ */
+static void turn_queue_apply(struct game_ctx * game)
+{
+  struct turn_queue * turns = &game->turns;
+
+  while (turns->count > 0)
   {
-    snake->prev_velocity = snake->velocity;
-    snake->velocity      = velocity;
+    enum velocity_t velocity = turns->velocities[0];
+    bool            is_stale = (game->tick_count - turns->ticks[0]
+                                  > turns->max_age);
+
+    // shift the rest of the queue forward
+    turns->count--;
+    memmove(turns->velocities, turns->velocities + 1,
+      turns->count * sizeof(turns->velocities[0]));
+    memmove(turns->ticks, turns->ticks + 1,
+      turns->count * sizeof(turns->ticks[0]));
+
+    if (!is_stale)
+    {
+      snake_set_velocity(game, velocity);
+      break;
+    }
   }
 }
 
@@ -358,31 +1098,29 @@ void snake_set_velocity(enum velocity_t velocity)
  * ------------------------
  * update the state machine by moving to the specified state.
  *
+ * game:   the game whose state changes
  * new_gs: the new gamestate to enter
  *
  * returns: true if the state was updated, false if not able to enter this state
  */
-bool gamestate_set(enum gamestate_t new_gs)
+bool gamestate_set(struct game_ctx * game, enum gamestate_t new_gs)
 {
-  // TODO when entering the pause state from GS_RUNNING,
-  // TODO we should take snake->powerup_expire_ns and subtract from it
-  // TODO the value returned by get_time_ns(). This will provide the # of
-  // TODO nanoseconds of powerup remaining. When re-entering GS_RUNNING
-  // TODO we simply set snake->powerup_expire_ns to get_time_ns() + the value
-
-  bool can_transition = gamestate_can_transition(game_state, new_gs);
+  bool can_transition = gamestate_can_transition(game->state, new_gs);
 
   // TODO change game_state to cur_gs
 
   if (can_transition)
   {
-    // handle entering a new gamestate
-    switch (new_gs)
-    {
-      // TODO
-    }
+    // a game that ended can only start over
+    if (GS_ENDING == game->state && GS_STARTING == new_gs)
+      game_restart(game);
+
+    // timed effects (e.g. powerups) are only counted down while running
+    timer_wheel_set_paused(&game->timers, GS_RUNNING != new_gs);
 
-    game_state = new_gs;
+    game->state = new_gs;
+
+    TRACE_INSTANT("gamestate", gamestate_to_string(new_gs), new_gs);
   }
 
   return can_transition;
@@ -411,8 +1149,7 @@ static bool gamestate_can_transition(enum gamestate_t from, enum gamestate_t to)
       can_transition = (GS_RUNNING == to || GS_ENDING == to);
       break;
 
-    // from GS_ENDING, we can only enter GS_STARTING
-    // TODO handle restarting game from game over screen
+    // from GS_ENDING, we can only enter GS_STARTING (see game_restart)
     case GS_ENDING:
       can_transition = (GS_STARTING == to);
       break;
@@ -477,11 +1214,11 @@ const char * powerup_to_string(enum powerup_t powerup)
  * ----------------------
  * TODO: Documentation
  */
-static void powerup_init(void)
+static void powerup_init(struct game_ctx * game)
 {
   // initialize powerup durations
-  powerup_durations[PU_SINGLESTEP] = (nanosecond_t) PU_SINGLESTEP_DUR * SECONDS;
-  powerup_durations[PU_NOGROW]     = (nanosecond_t) PU_NOGROW_DUR * SECONDS; 
+  game->powerup_durations[PU_SINGLESTEP] = PU_SINGLESTEP_DUR;
+  game->powerup_durations[PU_NOGROW]     = PU_NOGROW_DUR;
 }
 
 /**
@@ -491,10 +1228,10 @@ static void powerup_init(void)
  *
  * returns: a randomly-selected powerup
  */
-static enum powerup_t rand_powerup(void)
+static enum powerup_t rand_powerup(struct game_ctx * game)
 {
   // TODO use probabilities
-  return (enum powerup_t)(rand() % PU_COUNT);
+  return (enum powerup_t) rng_bounded(&game->rng, PU_COUNT);
 }
 
 /*
@@ -503,73 +1240,120 @@ static enum powerup_t rand_powerup(void)
  * TODO - Documentation
  */
 static void powerup_activate(
+    struct game_ctx              * game,
     struct game_updatecycle_info * p_uc_info,
     enum   powerup_t               powerup
 )
 {
-  snake->powerup           = powerup;
-  snake->powerup_expire_ns = p_uc_info->start_ns + powerup_durations[powerup];
+  struct ent_snake * snake = &game->snake;
+
+  // an active powerup that is picked up again restarts
+  if (snake->powerups & PU_BIT(powerup))
+    timer_wheel_cancel(&game->timers, snake->powerup_timers[powerup]);
+
+  if (!timer_wheel_schedule(&game->timers, game->powerup_durations[powerup],
+    GAME_TIMER_POWERUP, powerup, &snake->powerup_timers[powerup]))
+  {
+    snake->powerups &= ~PU_BIT(powerup);
+    return;
+  }
+
+  snake->powerup   = powerup;
+  snake->powerups |= PU_BIT(powerup);
+
+  TRACE_INSTANT("powerup_on", powerup_to_string(powerup), powerup);
 
-  // don't waste time checking expiry for newly-acquired powerup
-  powerup_tick(p_uc_info, false);
+  powerup_tick(game, p_uc_info);
 }
 
 /**
- * function:  powerup_tick
- * -----------------------
- * TODO - Documentation
+ * function:  powerup_expire
+ * -------------------------
+ * ends an active powerup (when its timer fires).
  *
- * When enabling a newly-acquired (aka just consumed) powerup, check_expiry
- * should be set to false so no time is wasted checking if the powerup is
- * expired.
- *
- * p_uc_info:     current update cycle's info struct
- * check_expiry:  if true, check if the powerup should expire
+ * game:    the game whose powerup expires
+ * powerup: the powerup
  */
-static void powerup_tick(
-    struct game_updatecycle_info * p_uc_info,
-    bool   check_expiry
-)
+static void powerup_expire(struct game_ctx * game, enum powerup_t powerup)
 {
-  // return immediately if no powerup is active
-  if (PU_NONE == snake->powerup)
+  struct ent_snake * snake = &game->snake;
+  unsigned int       pu;
+
+  if (!(snake->powerups & PU_BIT(powerup)))
     return;
 
-  // check if powerup has expired
-  if (check_expiry)
-  {
-    if (p_uc_info->start_ns >= snake->powerup_expire_ns)
-    {
-      // resume snake momentum if single-step powerup expires
-      if (PU_SINGLESTEP == snake->powerup)
-      {
-        snake_set_velocity(snake->prev_velocity);
+  snake->powerups &= ~PU_BIT(powerup);
+
+  // resume snake momentum if single-step powerup expires
+  if (PU_SINGLESTEP == powerup)
+    snake_set_velocity(game, snake->prev_velocity);
 
-        // ensure snake doesn't return to VEL_NONE
-        p_uc_info->snake_new_velocity = snake->velocity;
-     }
+  TRACE_INSTANT("powerup_off", powerup_to_string(powerup), powerup);
 
-      snake->powerup = PU_NONE;
+  // fall back to another powerup that is still active
+  if (snake->powerup == powerup)
+  {
+    snake->powerup = PU_NONE;
+
+    for (pu = 0; pu < PU_COUNT; pu++)
+    {
+      if (snake->powerups & PU_BIT(pu))
+        snake->powerup = pu;
     }
   }
+}
 
-  // set update cycle information based on powerup
-  switch (snake->powerup)
-  {
-    // no powerup
-    case PU_NONE:
-    case PU_COUNT:
-      break;
+/**
+ * function:  game_timer_fire
+ * --------------------------
+ * does what a game's timer does when it fires (see enum game_timer_t).
+ *
+ * ctx:   the game
+ * kind:  the timer's kind
+ * arg:   the timer's argument
+ */
+static void game_timer_fire(void * ctx, unsigned int kind, uint32_t arg)
+{
+  struct game_ctx * game = ctx;
 
-    // snake moves one unit at a time with this powerup
-    case PU_SINGLESTEP:
-      p_uc_info->snake_new_velocity = VEL_NONE;
+  switch (kind)
+  {
+    case GAME_TIMER_POWERUP:
+      if (arg < PU_COUNT)
+        powerup_expire(game, (enum powerup_t) arg);
       break;
 
-    // snake does not grow when consuming food with this powerup
-    case PU_NOGROW:
-      p_uc_info->snake_can_grow = false;
+    default:
       break;
   }
 }
 
+/**
+ * function:  powerup_tick
+ * -----------------------
+ * applies the effects of every active powerup to the update cycle. Expiry
+ * is left to the game's timers, so this never checks the time.
+ *
+ * game:          the game whose powerups apply
+ * p_uc_info:     current update cycle's info struct
+ */
+static void powerup_tick(
+    struct game_ctx              * game,
+    struct game_updatecycle_info * p_uc_info
+)
+{
+  struct ent_snake * snake = &game->snake;
+
+  // return immediately if no powerup is active
+  if (0 == snake->powerups)
+    return;
+
+  // snake moves one unit at a time with this powerup
+  if (snake->powerups & PU_BIT(PU_SINGLESTEP))
+    p_uc_info->snake_new_velocity = VEL_NONE;
+
+  // snake does not grow when consuming food with this powerup
+  if (snake->powerups & PU_BIT(PU_NOGROW))
+    p_uc_info->snake_can_grow = false;
+}
+
@@ -3,58 +3,89 @@
  *
  * tty-snake graphics module.
  *
+ * Every update composes the complete frame (titlebar, border, board and
+ * popup) into the damage-tracked screen, which only hands the cells that
+ * changed since the last update over to the backend driving the terminal.
+ * Updates draw frame snapshots rather than the game itself, so that they can
+ * run on a thread of their own while the game goes on.
+ *
  * See LICENSE for copyright information.
  */
 
-#include <ncurses.h>
-#include <stdio.h>   // sprintf()
+#include <stdio.h> // snprintf()
 
+#include <backend.h>
+#include <frame.h>
 #include <game.h>
+#include <hud.h>
+#include <screen.h>
 
 #include <graphics.h>
 
 // external global variables
 bool is_graphics_setup = false; // graphics.h
 
-unsigned int game_x_bound; // game.h
-unsigned int game_y_bound; // game.h
-struct ent_food  * food;   // game.h
-struct ent_snake * snake;  // game.h
-
 // global variables
-static int      old_curs;
-static WINDOW * popup_win = NULL;
+static const struct graphics_backend * backend = NULL;
+static struct graphics_stats           stats;
+
+// backends by enum graphics_backend_t
+static const struct graphics_backend * const
+  backends[GRAPHICS_BACKEND_COUNT] = {
+  [GRAPHICS_BACKEND_NCURSES] = &ncurses_backend,
+  [GRAPHICS_BACKEND_ANSI]    = &ansi_backend
+};
+
+// formatted titlebar, kept until one of the values shown in it changes
+// (initially use illegal state so that the first update formats it)
+static char             titlebar_text[TITLEBAR_MAX_LEN];
+static enum gamestate_t titlebar_state   = GS_COUNT;
+static unsigned int     titlebar_score   = 0;
+static enum powerup_t   titlebar_powerup = PU_NONE;
+static bool             titlebar_hud     = false;
+
+// formatted performance HUD, kept until one of its numbers changes
+static char             hud_text[HUD_MAX_LEN];
+static struct hud_meter frame_meter; // frames drawn, and their output
+static bool             is_hud_dirty = true;
+static unsigned int     hud_length   = 0;
 
 // private forward declarations
-static void draw_titlebar(void);
-static void draw_lines_centered(WINDOW*,const char**,size_t);
+static void draw_titlebar(const struct frame *);
+static void draw_hud(const struct frame *, unsigned int);
+static void draw_border(const struct frame *);
+static void draw_board(const struct frame *);
+static void draw_popup(int, int, const char**, size_t);
+
+static void draw_gs_starting(void);
+static void draw_gs_paused(void);
+static void draw_gs_ending(const struct frame *);
 
-static void draw_gs_starting(bool);
-static void draw_gs_running(bool);
-static void draw_gs_paused(bool);
-static void draw_gs_ending(bool);
+static void format_amount(char *, size_t, uint64_t, const char *);
+static void format_duration(char *, size_t, nanosecond_t);
 
 /**
  * function:  graphics_setup
  * -------------------------
  * initializes the graphics module.
+ *
+ * backend_id:  backend to drive the terminal with
+ * x_bound:     set to the terminal width (the game area width)
+ * y_bound:     set to the terminal height (the game area height)
  */
-void graphics_setup(void)
+void graphics_setup(enum graphics_backend_t backend_id, unsigned int * x_bound,
+  unsigned int * y_bound)
 {
   if (!is_graphics_setup)
   {
-    // ncurses setup
-    initscr();
-    raw();
-    keypad(stdscr, true);
-    noecho();
-    cbreak();
-    getmaxyx(stdscr, game_y_bound, game_x_bound);
+    backend = backends[(backend_id < GRAPHICS_BACKEND_COUNT)
+      ? backend_id : GRAPHICS_BACKEND_NCURSES];
 
-    old_curs  = curs_set(0);
+    if (!backend->setup(x_bound, y_bound)
+      || !screen_setup(*x_bound, *y_bound))
+      quit();
 
-    // draw game area boundary (use defaults since they look pretty)
-    border(0,0,0,0,0,0,0,0);
+    memset(&stats, 0, sizeof(stats));
 
     is_graphics_setup = true;
   }
@@ -63,48 +94,100 @@ void graphics_setup(void)
 /**
  * function:  graphics_update
  * --------------------------
- * updates the on-screen graphics.
+ * updates the on-screen graphics, writing nothing if nothing changed.
+ *
+ * frame: the frame to draw (see frame_capture)
  */
-void graphics_update(void)
+void graphics_update(const struct frame * frame)
 {
-  // initially use illegal state so prev_game_state != game_state initially
-  static enum gamestate_t prev_game_state = GS_COUNT;
-  bool is_gamestate_change                = (prev_game_state != game_state);
+  unsigned int n_cells;
+  size_t       n_bytes = 0;
 
-  draw_titlebar();
-
-  // close popup window if changing states
-  if (is_gamestate_change)
+  // the HUD's frame meter only runs while the HUD is shown
+  if (frame->hud.is_shown)
   {
-    nc_window_destroy(popup_win, true);
-    popup_win = NULL;
+    if (!titlebar_hud)
+    {
+      hud_meter_reset(&frame_meter, get_time_ns());
+      is_hud_dirty = true;
+    }
+
+    is_hud_dirty |= hud_meter_roll(&frame_meter, get_time_ns());
   }
 
-  // determine what to display based on game state
-  switch (game_state)
+  draw_titlebar(frame);
+  draw_border(frame);
+  draw_board(frame);
+
+  // determine which popup to display based on game state
+  switch (frame->state)
   {
     // draw the pre-game welcome message
     case GS_STARTING:
-      draw_gs_starting(is_gamestate_change);
+      draw_gs_starting();
       break;
 
-    // draw game elements
+    // no popup over the game
     case GS_RUNNING:
-      draw_gs_running(is_gamestate_change);
+    case GS_COUNT:
       break;
 
     // draw pause menu
     case GS_PAUSED:
-      draw_gs_paused(is_gamestate_change);
+      draw_gs_paused();
       break;
 
     // draw post-game stats
     case GS_ENDING:
-      draw_gs_ending(is_gamestate_change);
-      break;  
+      draw_gs_ending(frame);
+      break;
   }
 
-  prev_game_state = game_state;
+  stats.frames++;
+
+  n_cells = screen_flush(backend->emit);
+
+  if (n_cells > 0)
+  {
+    n_bytes = backend->flush();
+
+    stats.flushes++;
+    stats.cells += n_cells;
+    stats.bytes += n_bytes;
+  }
+
+  // backends that can't tell how much they wrote are metered in cells
+  if (frame->hud.is_shown)
+    hud_meter_record(&frame_meter, 0, stats.bytes ? n_bytes : n_cells);
+}
+
+/**
+ * function:  graphics_invalidate
+ * ------------------------------
+ * makes the next update re-emit every cell instead of only the ones that
+ * changed (e.g. after the game state was restored from a snapshot).
+ */
+void graphics_invalidate(void)
+{
+  if (is_graphics_setup)
+    screen_invalidate();
+}
+
+/**
+ * function:  graphics_resize
+ * --------------------------
+ * adapts to a new terminal size (on SIGWINCH) and makes the next update
+ * redraw the whole screen. The game area keeps its size.
+ */
+void graphics_resize(void)
+{
+  unsigned int width, height;
+
+  if (!is_graphics_setup)
+    return;
+
+  if (!backend->resize(&width, &height) || !screen_resize(width, height))
+    quit();
 }
 
 /**
@@ -116,226 +199,409 @@ void graphics_unset(void)
 {
   if (is_graphics_setup)
   {
-    nc_window_destroy(popup_win, false);
-
-    // ncurses unset
-    refresh();
-    curs_set(old_curs);
-    endwin();
+    screen_unset();
+    backend->unset();
 
     is_graphics_setup = false;
   }
 }
 
-
 /**
- * function:  draw_titlebar
- * ------------------------
- * TODO - Documentation
+ * function:  graphics_getch
+ * -------------------------
+ * reads a key from the terminal without blocking.
+ *
+ * returns: the key (arrow keys as KEY_UP, KEY_DOWN, ...), or ERR if no key
+ *            is waiting
  */
-static void draw_titlebar(void)
+int graphics_getch(void)
 {
-  // re-draw top border
-  mvhline(0, 1, ACS_HLINE, game_x_bound - 2);
-
-  // draw gamestate string
-  mvprintw(0, 2, "[ %s | SCORE: %d | POWERUP: %s ]",
-    gamestate_to_string(game_state),
-    game_score,
-    powerup_to_string(snake->powerup)
-    // TODO show time remaining by modifying powerup_to_string result
-  ); 
+  return is_graphics_setup ? backend->read_key() : ERR;
 }
 
+/**
+ * function:  graphics_get_stats
+ * -----------------------------
+ * p_stats: set to the output statistics since graphics_setup
+ */
+void graphics_get_stats(struct graphics_stats * p_stats)
+{
+  *p_stats = stats;
+}
 
-/*
- * Per-gamestate update functions
+/**
+ * function:  graphics_backend_from_string
+ * ---------------------------------------
+ * name:  backend name (as in graphics_backend_to_string)
+ *
+ * returns: the backend, or GRAPHICS_BACKEND_COUNT if there is none by that
+ *            name
  */
+enum graphics_backend_t graphics_backend_from_string(const char * name)
+{
+  enum graphics_backend_t backend_id;
+
+  for (backend_id = 0; backend_id < GRAPHICS_BACKEND_COUNT; backend_id++)
+    if (0 == strcmp(name, backends[backend_id]->name))
+      break;
+
+  return backend_id;
+}
 
 /**
- * function:  draw_lines_centered
- * ------------------------------
- * draws the provided lines of characters to the specified window, centering
- * them vertically and horizontally.
+ * function:  graphics_backend_to_string
+ * -------------------------------------
+ * backend_id:  the backend
  *
- * TODO - rest of documentation
+ * returns: the backend's name
  */
-static void draw_lines_centered(WINDOW * win, const char ** lines, size_t nlines)
+const char * graphics_backend_to_string(enum graphics_backend_t backend_id)
 {
-  int    win_height, win_width;
-  size_t i;
+  return (backend_id < GRAPHICS_BACKEND_COUNT)
+    ? backends[backend_id]->name
+    : "unknown";
+}
 
-  // fetch window height and width
-  getmaxyx(win, win_height, win_width);
 
-  // print all lines, centered
-  for (i = 0; i < nlines; i++)
+/**
+ * function:  draw_titlebar
+ * ------------------------
+ * draws the top border with the gamestate, score and powerup in it, and
+ * the performance HUD if it is shown (which takes the gamestate's place).
+ * The text is only re-formatted when one of them changed.
+ */
+static void draw_titlebar(const struct frame * frame)
+{
+  if (titlebar_state != frame->state || titlebar_score != frame->score
+    || titlebar_powerup != frame->powerup
+    || titlebar_hud != frame->hud.is_shown)
   {
-    size_t line_len = strlen(lines[i]);
+    titlebar_state   = frame->state;
+    titlebar_score   = frame->score;
+    titlebar_powerup = frame->powerup;
+    titlebar_hud     = frame->hud.is_shown;
 
-    // don't bother printing blank lines
-    if (line_len > 0)
+    if (titlebar_hud)
     {
-      int line_y = (win_height / 2) + 1 - (nlines - i);
-      int line_x = (win_width / 2) - (line_len / 2);
-
-      mvwprintw(win, line_y, line_x, lines[i]);
+      snprintf(titlebar_text, sizeof(titlebar_text),
+        "[ SCORE: %d | POWERUP: %s ]",
+        titlebar_score,
+        powerup_to_string(titlebar_powerup)
+      );
+    }
+    else
+    {
+      snprintf(titlebar_text, sizeof(titlebar_text),
+        "[ %s | SCORE: %d | POWERUP: %s ]",
+        gamestate_to_string(titlebar_state),
+        titlebar_score,
+        powerup_to_string(titlebar_powerup)
+        // TODO show time remaining by modifying powerup_to_string result
+      );
     }
   }
+
+  // top border, with the titlebar text over it
+  screen_set(0, 0, GLYPH_ULCORNER);
+  screen_fill(1, 0, frame->x_bound - 2, 1, GLYPH_HLINE);
+  screen_set(frame->x_bound - 1, 0, GLYPH_URCORNER);
+
+  screen_text(TITLEBAR_X, 0, titlebar_text, SCELL_NORMAL);
+
+  if (titlebar_hud)
+    draw_hud(frame, TITLEBAR_X + strlen(titlebar_text) + 1);
 }
 
 /**
- * function:  draw_gs_starting
- * ---------------------------
- * TODO - Documentation
+ * function:  draw_hud
+ * -------------------
+ * draws the performance HUD at the right end of the titlebar: game updates
+ * per second and their 99th percentile time, frames per second and the
+ * output they cost, and the snake's length and board occupancy. The numbers
+ * only change once per HUD_WINDOW_NS (or when the snake grows), and only
+ * then is the text re-formatted.
+ *
+ * frame: the frame being drawn
+ * min_x: leftmost column the HUD may start at (it is cut off on the right
+ *          if it doesn't fit)
  */
-static void draw_gs_starting(bool is_gamestate_change)
+static void draw_hud(const struct frame * frame, unsigned int min_x)
 {
-  if (is_gamestate_change)
+  unsigned int x, i;
+
+  if (is_hud_dirty || hud_length != frame->length)
   {
-    // lines to display (centered horiz. and vert.)
-    const char * lines[2] = {
-      "TTY-SNAKE         v0.0",
-      "PRESS ANY KEY TO START"
-    };
+    char tick_p99[HUD_UNIT_MAX_LEN],
+         output[HUD_UNIT_MAX_LEN];
+    unsigned int n_interior = (frame->x_bound - 2) * (frame->y_bound - 2);
+
+    hud_length   = frame->length;
+    is_hud_dirty = false;
+
+    format_duration(tick_p99, sizeof(tick_p99), frame->hud.tick_p99_ns);
+    format_amount(output, sizeof(output), frame_meter.amount_rate,
+      stats.bytes ? "B/s" : "c/s");
+
+    snprintf(hud_text, sizeof(hud_text),
+      "[ %utps p99 %s | %ufps %s | %u %u%% ]",
+      frame->hud.tick_rate,
+      tick_p99,
+      frame_meter.rate,
+      output,
+      hud_length,
+      n_interior ? hud_length * 100 / n_interior : 0
+    );
+  }
 
-    int win_height = WIN_STARTING_HEIGHT,
-        win_width  = WIN_STARTING_WIDTH,
-        win_y      = (LINES - win_height) / 2,
-        win_x      = (COLS - win_width) / 2;
+  // right-aligned, unless that would cover the rest of the titlebar
+  x = frame->x_bound - HUD_RIGHT_MARGIN - strlen(hud_text);
 
-    // create the popup window
-    popup_win = nc_window_create(win_height, win_width, win_y, win_x);
+  if (strlen(hud_text) + HUD_RIGHT_MARGIN > frame->x_bound || x < min_x)
+    x = min_x;
 
-    // draw box around popup window
-    box(popup_win, 0, 0);
+  for (i = 0; hud_text[i] && x + i < frame->x_bound - 1; i++)
+    screen_set(x + i, 0, (unsigned char) hud_text[i] | SCELL_NORMAL);
+}
+
+/**
+ * function:  draw_border
+ * ----------------------
+ * draws the game area boundary below the titlebar.
+ */
+static void draw_border(const struct frame * frame)
+{
+  unsigned int bottom = frame->y_bound - 1,
+               right  = frame->x_bound - 1;
 
-    // display window text
-    draw_lines_centered(popup_win, lines, sizeof(lines) / sizeof(lines[0]));
+  screen_fill(0, 1, 1, bottom - 1, GLYPH_VLINE);
+  screen_fill(right, 1, 1, bottom - 1, GLYPH_VLINE);
 
-    wrefresh(popup_win);
-  }
+  screen_set(0, bottom, GLYPH_LLCORNER);
+  screen_fill(1, bottom, right - 1, 1, GLYPH_HLINE);
+  screen_set(right, bottom, GLYPH_LRCORNER);
 }
 
 /**
- * function:  draw_gs_running
- * --------------------------
- * TODO - Documentation
+ * function:  draw_board
+ * ---------------------
+ * draws the game area's interior from the frame's occupancy grid, then the
+ * snake's head and tail.
  */
-static void draw_gs_running(bool is_gamestate_change)
+static void draw_board(const struct frame * frame)
 {
-  struct ent_snake_seg * dead_seg = snake->tail;
+  scell_t      food_display_ch;
+  unsigned int x, y;
 
-  // erase dead segments from screen
-  while (dead_seg && dead_seg->dying)
+  // special display if food has powerup
+  switch (frame->food_powerup)
   {
-    // printw overwrites text, use it instead of delch()
-    mvprintw(dead_seg->y, dead_seg->x, " ");
-    dead_seg = dead_seg->prev;
-  }
+    case PU_SINGLESTEP:
+      food_display_ch = PU_SINGLESTEP_DISP;
+      break;
+
+    case PU_NOGROW:
+      food_display_ch = PU_NOGROW_DISP;
+      break;
 
-  // draw entities
-  // TODO maybe check if either entity has moved? how?
+    // PU_NONE, other non-valid states
+    default:
+      food_display_ch = ENT_FOOD_DISP;
+      break;
+  }
 
-  // overwrite previous head with body segment, if body segments exist
-  if (snake->length > 2)
-    mvaddch(snake->head->next->y, snake->head->next->x, ENT_SNAKE_DISP);
+  for (y = 1; y < frame->y_bound - 1; y++)
+  {
+    for (x = 1; x < frame->x_bound - 1; x++)
+    {
+      switch (FRAME_CELL_AT(frame, x, y))
+      {
+        case CELL_SNAKE:
+          screen_set(x, y, ENT_SNAKE_DISP);
+          break;
+
+        case CELL_FOOD:
+          screen_set(x, y, food_display_ch);
+          break;
+
+        default:
+          screen_set(x, y, ' ');
+          break;
+      }
+    }
+  }
 
   // draw tail if it is not the head
-  if (snake->length > 1)
-    mvaddch(dead_seg->y, dead_seg->x, ENT_SNAKE_TAIL_DISP);
+  if (frame->length > 1)
+    screen_set(COORD_X(frame->tail), COORD_Y(frame->tail),
+      ENT_SNAKE_TAIL_DISP);
 
   // draw head
-  mvaddch(snake->head->y, snake->head->x, ENT_SNAKE_HEAD_DISP);
+  screen_set(COORD_X(frame->head), COORD_Y(frame->head), ENT_SNAKE_HEAD_DISP);
+}
+
+
+/*
+ * Per-gamestate popup functions
+ */
+
+/**
+ * function:  draw_popup
+ * ---------------------
+ * draws a boxed popup in the middle of the screen, over the game, with the
+ * provided lines of characters centered vertically and horizontally in it.
+ *
+ * height:  popup height (including the box)
+ * width:   popup width (including the box)
+ * lines:   lines to display
+ * nlines:  number of lines
+ */
+static void draw_popup(int height, int width, const char ** lines,
+  size_t nlines)
+{
+  int    y = ((int) screen_height() - height) / 2,
+         x = ((int) screen_width() - width) / 2;
+  size_t i;
+
+  // popups larger than the screen are cut off on the right and bottom
+  if (y < 0)
+    y = 0;
+
+  if (x < 0)
+    x = 0;
+
+  // box around the popup, blank inside
+  screen_set(x, y, GLYPH_ULCORNER);
+  screen_fill(x + 1, y, width - 2, 1, GLYPH_HLINE);
+  screen_set(x + width - 1, y, GLYPH_URCORNER);
 
-  if (!food->consumed)
+  screen_fill(x, y + 1, 1, height - 2, GLYPH_VLINE);
+  screen_fill(x + 1, y + 1, width - 2, height - 2, ' ');
+  screen_fill(x + width - 1, y + 1, 1, height - 2, GLYPH_VLINE);
+
+  screen_set(x, y + height - 1, GLYPH_LLCORNER);
+  screen_fill(x + 1, y + height - 1, width - 2, 1, GLYPH_HLINE);
+  screen_set(x + width - 1, y + height - 1, GLYPH_LRCORNER);
+
+  // print all lines, centered
+  for (i = 0; i < nlines; i++)
   {
-    char food_display_char;
+    size_t line_len = strlen(lines[i]);
 
-    // special display if food has powerup
-    switch (food->powerup)
+    // don't bother printing blank lines
+    if (line_len > 0)
     {
-      case PU_SINGLESTEP:
-        food_display_char = PU_SINGLESTEP_DISP;
-        break;
-
-      case PU_NOGROW:
-        food_display_char = PU_NOGROW_DISP;
-        break; 
-
-      // PU_NONE, other non-valid states
-      default:
-        food_display_char = ENT_FOOD_DISP;
-        break;
-    }
+      int line_y = (height / 2) + 1 - (nlines - i);
+      int line_x = (width / 2) - (line_len / 2);
 
-    mvaddch(food->y, food->x, food_display_char);
+      screen_text(x + line_x, y + line_y, lines[i], SCELL_NORMAL);
+    }
   }
 }
 
+/**
+ * function:  draw_gs_starting
+ * ---------------------------
+ * draws the pre-game welcome popup.
+ */
+static void draw_gs_starting(void)
+{
+  // lines to display (centered horiz. and vert.)
+  const char * lines[2] = {
+    "TTY-SNAKE         v0.0",
+    "PRESS ANY KEY TO START"
+  };
+
+  draw_popup(WIN_STARTING_HEIGHT, WIN_STARTING_WIDTH, lines,
+    sizeof(lines) / sizeof(lines[0]));
+}
+
 /**
  * function:  draw_gs_paused
  * -------------------------
- * TODO - Documentation
+ * draws the pause popup.
  */
-static void draw_gs_paused(bool is_gamestate_change)
+static void draw_gs_paused(void)
 {
-  if (is_gamestate_change)
-  {
-    // lines to display (centered horiz. and vert.)
-    const char * lines[2] = {
-      "GAME PAUSED",
-      "PRESS P TO UNPAUSE"
-    };
-
-    int win_height = WIN_PAUSE_HEIGHT,
-        win_width  = WIN_PAUSE_WIDTH,
-        win_y      = (LINES - win_height) / 2,
-        win_x      = (COLS - win_width) / 2;
-
-    // create the popup window
-    popup_win = nc_window_create(win_height, win_width, win_y, win_x);
-
-    // draw box around popup window
-    box(popup_win, 0, 0);
-
-    // display window text
-    draw_lines_centered(popup_win, lines, sizeof(lines) / sizeof(lines[0]));
-
-    wrefresh(popup_win);
-  }
+  // lines to display (centered horiz. and vert.)
+  const char * lines[2] = {
+    "GAME PAUSED",
+    "PRESS P TO UNPAUSE"
+  };
+
+  draw_popup(WIN_PAUSE_HEIGHT, WIN_PAUSE_WIDTH, lines,
+    sizeof(lines) / sizeof(lines[0]));
 }
 
 /**
  * function:  draw_gs_ending
  * -------------------------
- * TODO - Documentation
+ * draws the post-game popup.
  */
-static void draw_gs_ending(bool is_gamestate_change)
+static void draw_gs_ending(const struct frame * frame)
 {
-  if (is_gamestate_change)
-  {
-    // lines to display (centered horiz. and vert.)
-    const char * lines[2] = {
-      "GAME OVER",
-      "PRESS ANY KEY TO EXIT"
-    };
+  // lines to display (centered horiz. and vert.)
+  const char * lines[2] = {
+    frame->won ? "YOU WIN" : "GAME OVER",
+    "PRESS R TO RESTART OR ANY KEY TO EXIT"
+  };
+
+  draw_popup(WIN_GAMEOVER_HEIGHT, WIN_GAMEOVER_WIDTH, lines,
+    sizeof(lines) / sizeof(lines[0]));
+}
 
-    int win_height = WIN_GAMEOVER_HEIGHT,
-        win_width  = WIN_GAMEOVER_WIDTH,
-        win_y      = (LINES - win_height) / 2,
-        win_x      = (COLS - win_width) / 2;
 
-    // create the popup window
-    popup_win = nc_window_create(win_height, win_width, win_y, win_x);
+/*
+ * HUD formatting functions
+ */
 
-    // draw box around popup window
-    box(popup_win, 0, 0);
+/**
+ * function:  format_amount
+ * ------------------------
+ * formats an amount with a metric prefix, e.g. 3500 B/s as "3.5kB/s".
+ *
+ * buf:   where to format the amount
+ * size:  size of buf
+ * value: the amount
+ * unit:  unit to append
+ */
+static void format_amount(char * buf, size_t size, uint64_t value,
+  const char * unit)
+{
+  const char * const prefixes[] = { "", "k", "M", "G" };
 
-    // display window text
-    draw_lines_centered(popup_win, lines, sizeof(lines) / sizeof(lines[0]));
+  double       scaled = value;
+  unsigned int i      = 0;
 
-    wrefresh(popup_win);
+  while (scaled >= 1000.0 && i < 3)
+  {
+    scaled /= 1000.0;
+    i++;
   }
+
+  if (0 == i)
+    snprintf(buf, size, "%llu%s", (unsigned long long) value, unit);
+  else
+    snprintf(buf, size, "%.1f%s%s", scaled, prefixes[i], unit);
 }
 
+/**
+ * function:  format_duration
+ * --------------------------
+ * formats a duration in the largest unit it takes at least one of, e.g.
+ * 2100 ns as "2.1us".
+ *
+ * buf:   where to format the duration
+ * size:  size of buf
+ * ns:    the duration
+ */
+static void format_duration(char * buf, size_t size, nanosecond_t ns)
+{
+  if (ns < 1000)
+    snprintf(buf, size, "%lluns", (unsigned long long) ns);
+  else if (ns < MILLISECONDS)
+    snprintf(buf, size, "%.1fus", ns / 1000.0);
+  else if (ns < SECONDS)
+    snprintf(buf, size, "%.1fms", (double) ns / MILLISECONDS);
+  else
+    snprintf(buf, size, "%.1fs", (double) ns / SECONDS);
+}
@@ -0,0 +1,94 @@
+/**
+ * hist.c
+ *
+ * tty-snake fixed-size log-linear (HDR-style) histograms.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <hist.h>
+
+// private forward declarations
+static uint64_t hist_bucket_max(unsigned int index);
+
+
+/**
+ * function:  hist_reset
+ * ---------------------
+ * forgets every value recorded.
+ *
+ * hist:  the histogram
+ */
+void hist_reset(struct hist * hist)
+{
+  memset(hist, 0, sizeof(*hist));
+}
+
+/**
+ * function:  hist_percentile
+ * --------------------------
+ * hist:        the histogram
+ * percentile:  percentile to look up (0 to 100)
+ *
+ * returns: the largest value that falls into the same bucket as the value
+ *            at the percentile (never more than the maximum), or 0 if
+ *            nothing was recorded
+ */
+uint64_t hist_percentile(const struct hist * hist, double percentile)
+{
+  double       exact_rank = percentile / 100.0 * hist->count;
+  uint64_t     rank       = (uint64_t) exact_rank,
+               seen       = 0;
+  unsigned int i;
+
+  if (0 == hist->count)
+    return 0;
+
+  // nearest rank (counting from 1) of the value at the percentile
+  if (rank < exact_rank || rank < 1)
+    rank++;
+
+  for (i = 0; i < HIST_BUCKETS; i++)
+  {
+    seen += hist->buckets[i];
+
+    if (seen >= rank)
+      return (hist_bucket_max(i) < hist->max) ? hist_bucket_max(i) : hist->max;
+  }
+
+  return hist->max;
+}
+
+/**
+ * function:  hist_mean
+ * --------------------
+ * hist:  the histogram
+ *
+ * returns: the mean of the values recorded (0 if there are none)
+ */
+double hist_mean(const struct hist * hist)
+{
+  return hist->count ? (double) hist->sum / hist->count : 0.0;
+}
+
+/**
+ * function:  hist_bucket_max
+ * --------------------------
+ * the inverse of hist_index.
+ *
+ * index: index of a bucket
+ *
+ * returns: the largest value the bucket holds
+ */
+static uint64_t hist_bucket_max(unsigned int index)
+{
+  unsigned int shift;
+
+  if (index < HIST_SUB_COUNT)
+    return index;
+
+  shift = (index >> HIST_SUB_BITS) - 1;
+
+  return (((uint64_t) HIST_SUB_COUNT + (index & (HIST_SUB_COUNT - 1)))
+    << shift) + ((uint64_t) 1 << shift) - 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * hud.c
+ *
+ * tty-snake rolling meters for the performance HUD.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <hud.h>
+
+
+/**
+ * function:  hud_meter_reset
+ * --------------------------
+ * starts a new window and forgets the last window's results.
+ *
+ * meter:   the meter
+ * now_ns:  the current time (see get_time_ns)
+ */
+void hud_meter_reset(struct hud_meter * meter, nanosecond_t now_ns)
+{
+  hist_reset(&meter->durations);
+
+  meter->start_ns    = now_ns;
+  meter->events      = 0;
+  meter->amount      = 0;
+  meter->rate        = 0;
+  meter->amount_rate = 0;
+  meter->p99_ns      = 0;
+}
+
+/**
+ * function:  hud_meter_roll
+ * -------------------------
+ * if the current window is over, computes its results and starts a new one.
+ *
+ * meter:   the meter
+ * now_ns:  the current time (see get_time_ns)
+ *
+ * returns: true if the results changed
+ */
+bool hud_meter_roll(struct hud_meter * meter, nanosecond_t now_ns)
+{
+  nanosecond_t elapsed_ns       = now_ns - meter->start_ns;
+  unsigned int prev_rate        = meter->rate;
+  uint64_t     prev_amount_rate = meter->amount_rate;
+  nanosecond_t prev_p99_ns      = meter->p99_ns;
+
+  if (elapsed_ns < HUD_WINDOW_NS)
+    return false;
+
+  meter->rate        = (unsigned int) ((meter->events * SECONDS
+                         + elapsed_ns / 2) / elapsed_ns);
+  meter->amount_rate = (meter->amount * SECONDS + elapsed_ns / 2)
+                         / elapsed_ns;
+  meter->p99_ns      = hist_percentile(&meter->durations, 99.0);
+
+  hist_reset(&meter->durations);
+
+  meter->start_ns = now_ns;
+  meter->events   = 0;
+  meter->amount   = 0;
+
+  return (prev_rate != meter->rate || prev_amount_rate != meter->amount_rate
+    || prev_p99_ns != meter->p99_ns);
+}
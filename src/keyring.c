@@ -0,0 +1,82 @@
+/**
+ * keyring.c
+ *
+ * tty-snake lock-free single-producer/single-consumer ring of key events.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <keyring.h>
+
+#define KEYRING_INDEX(n) ((n) & (KEYRING_CAPACITY - 1))
+
+
+/**
+ * function:  keyring_init
+ * -----------------------
+ * empties a ring. Must not race with keyring_push or keyring_pop.
+ *
+ * ring:  the ring
+ */
+void keyring_init(struct keyring * ring)
+{
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  ring->dropped = 0;
+}
+
+/**
+ * function:  keyring_push
+ * -----------------------
+ * appends an event to the ring. Only the producer thread may call this.
+ *
+ * ring:  the ring
+ * event: the event to append
+ *
+ * returns: false if the ring was full (the event is dropped)
+ */
+bool keyring_push(struct keyring * ring, const struct key_event * event)
+{
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  if (KEYRING_CAPACITY == tail - head)
+  {
+    ring->dropped++;
+    return false;
+  }
+
+  ring->events[KEYRING_INDEX(tail)] = *event;
+
+  // publishes the event to the consumer
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+  return true;
+}
+
+/**
+ * function:  keyring_pop
+ * ----------------------
+ * takes the oldest event off the ring. Only the consumer thread may call
+ * this.
+ *
+ * ring:  the ring
+ * event: where to store the event
+ *
+ * returns: false if the ring was empty
+ */
+bool keyring_pop(struct keyring * ring, struct key_event * event)
+{
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (head == tail)
+    return false;
+
+  *event = ring->events[KEYRING_INDEX(head)];
+
+  // hands the slot back to the producer
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  return true;
+}
@@ -0,0 +1,104 @@
+/**
+ * phase.c
+ *
+ * tty-snake per-phase timing of the engine's loop (see USE_PHASE_STATS and
+ * USE_TRACE).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <phase.h>
+
+#if defined(USE_PHASE_STATS) || defined(USE_TRACE)
+// external global variables
+_Thread_local nanosecond_t phase_mark_ns; // phase.h
+#endif
+
+#ifdef USE_PHASE_STATS
+
+// percentiles shown by the report
+static const double report_percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+// external global variables
+struct hist  phase_hists[PHASE_COUNT];      // phase.h
+uint64_t     phase_overruns[PHASE_COUNT];   // phase.h
+nanosecond_t phase_budgets_ns[PHASE_COUNT]; // phase.h
+
+
+/**
+ * function:  phase_reset
+ * ----------------------
+ * forgets every phase timed so far, and every phase's budget. Must not race
+ * with threads timing phases.
+ */
+void phase_reset(void)
+{
+  unsigned int i;
+
+  for (i = 0; i < PHASE_COUNT; i++)
+  {
+    hist_reset(&phase_hists[i]);
+    phase_overruns[i]   = 0;
+    phase_budgets_ns[i] = 0;
+  }
+}
+
+/**
+ * function:  phase_report
+ * -----------------------
+ * prints a table of every phase's duration percentiles (in nanoseconds) and
+ * overruns. Must not race with threads timing phases.
+ *
+ * out:           where to print the report
+ * missed_ticks:  tick deadlines the engine missed
+ * dropped_ticks: missed ticks that were skipped
+ */
+void phase_report(FILE * out, uint64_t missed_ticks, uint64_t dropped_ticks)
+{
+  unsigned int i, j;
+
+  fprintf(out, "[phases] %llu missed tick deadlines (%llu dropped)\n",
+    (unsigned long long) missed_ticks, (unsigned long long) dropped_ticks);
+
+  fprintf(out, "%-8s %9s %10s %10s %10s %10s %10s %10s %8s\n",
+    "phase", "count", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "p99.9_ns",
+    "max_ns", "overruns");
+
+  for (i = 0; i < PHASE_COUNT; i++)
+  {
+    const struct hist * hist = &phase_hists[i];
+
+    fprintf(out, "%-8s %9llu %10.0f", phase_to_string(i),
+      (unsigned long long) hist->count, hist_mean(hist));
+
+    for (j = 0; j < sizeof(report_percentiles) / sizeof(double); j++)
+      fprintf(out, " %10llu",
+        (unsigned long long) hist_percentile(hist, report_percentiles[j]));
+
+    fprintf(out, " %10llu %8llu\n", (unsigned long long) hist->max,
+      (unsigned long long) phase_overruns[i]);
+  }
+}
+
+#endif // USE_PHASE_STATS
+
+/**
+ * function:  phase_to_string
+ * --------------------------
+ * returns: the phase's name
+ */
+const char * phase_to_string(enum phase_t phase)
+{
+  const char * phase_names[PHASE_COUNT];
+
+  phase_names[PHASE_WAIT]    = "wait";
+  phase_names[PHASE_INPUT]   = "input";
+  phase_names[PHASE_UPDATE]  = "update";
+  phase_names[PHASE_PUBLISH] = "publish";
+  phase_names[PHASE_RENDER]  = "render";
+
+  if (PHASE_COUNT == phase)
+    return NULL;
+  else
+    return phase_names[phase];
+}
@@ -0,0 +1,534 @@
+/**
+ * replay.c
+ *
+ * tty-snake input recording and replay module.
+ *
+ * A replay file starts with REPLAY_MAGIC, the REPLAY_VERSION byte and the
+ * replay_header fields (as unsigned LEB128 varints). A stream of records
+ * follows, each starting with a one-byte tag:
+ *
+ *   REC_INPUT:     ticks since the previous record, input key
+ *   REC_KEYFRAME:  tick, snapshot size, snapshot (see game_snapshot_save)
+ *   REC_END:       ticks since the previous record
+ *
+ * All record fields are varints. Ticks without input are not stored, so a
+ * session costs a couple of bytes per keypress plus its keyframes.
+ *
+ * After REC_END comes the keyframe index: one (tick, file offset) pair per
+ * keyframe, as little-endian 64-bit integers. The file ends with a trailer
+ * holding the index offset (64 bits), the number of index entries (32 bits)
+ * and REPLAY_INDEX_MAGIC, so a reader can find any keyframe with a binary
+ * search over the mapped file without parsing the stream. Tick deltas
+ * restart at every keyframe, so reading can begin at any of them.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <fcntl.h>    // open()
+#include <ncurses.h>  // ERR
+#include <stdio.h>    // FILE
+#include <stdlib.h>   // malloc()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
+
+#include <game.h>
+
+#include <replay.h>
+
+// record tags
+#define REC_INPUT    1
+#define REC_KEYFRAME 2
+#define REC_END      3
+
+// sizes of the fixed-width parts of the file
+#define INDEX_ENTRY_SIZE 16
+#define TRAILER_SIZE     16
+
+// global variables
+static FILE          * record_file = NULL;
+static uint64_t        record_tick;          // tick of the last record
+static unsigned char * record_snapshot;      // keyframe snapshot buffer
+static uint64_t      * record_index;         // (tick, offset) pairs
+static size_t          record_index_count;
+static size_t          record_index_capacity;
+
+static const unsigned char * play_data = NULL; // mapped replay file
+static size_t                play_size;
+static size_t                play_pos;         // read position in play_data
+static const unsigned char * play_index;       // keyframe index (or NULL)
+static uint32_t              play_index_count;
+static uint64_t              play_base;        // tick of the previous record
+static uint64_t              play_tick;        // tick of the next event
+static int                   play_ch;          // key of the next event
+
+// private forward declarations
+static void     varint_write(FILE *, uint64_t);
+static bool     varint_read(uint64_t *);
+static void     u64_write(FILE *, uint64_t);
+static uint64_t u64_read(const unsigned char *);
+static void     play_advance(void);
+
+
+/*
+ * recording functions
+ */
+
+/**
+ * function:  replay_record_open
+ * -----------------------------
+ * starts recording a session.
+ *
+ * game:    the game being recorded (its board sizes the keyframes)
+ * path:    file to write the replay to
+ * header:  session information needed to reproduce it
+ *
+ * returns: true if recording started, false if the file can't be written
+ */
+bool replay_record_open(const struct game_ctx * game, const char * path,
+  const struct replay_header * header)
+{
+  record_file     = fopen(path, "wb");
+  record_snapshot = malloc(game_snapshot_size(game));
+
+  if (!record_file || !record_snapshot)
+  {
+    if (record_file)
+      fclose(record_file);
+
+    free(record_snapshot);
+    record_file = NULL;
+
+    return false;
+  }
+
+  fwrite(REPLAY_MAGIC, 1, strlen(REPLAY_MAGIC), record_file);
+  fputc(REPLAY_VERSION, record_file);
+
+  varint_write(record_file, header->seed);
+  varint_write(record_file, header->x_bound);
+  varint_write(record_file, header->y_bound);
+  varint_write(record_file, header->keyframe_interval);
+  varint_write(record_file, header->turn_max_age);
+
+  record_tick           = 0;
+  record_index          = NULL;
+  record_index_count    = 0;
+  record_index_capacity = 0;
+
+  return true;
+}
+
+/**
+ * function:  replay_record_input
+ * ------------------------------
+ * appends a keypress to the input log (ticks without input are skipped).
+ *
+ * tick:      engine tick the key was handled on
+ * input_ch:  the key (ERR if none)
+ */
+void replay_record_input(uint64_t tick, int input_ch)
+{
+  if (!record_file || ERR == input_ch)
+    return;
+
+  fputc(REC_INPUT, record_file);
+  varint_write(record_file, tick - record_tick);
+  varint_write(record_file, (uint64_t) input_ch);
+
+  record_tick = tick;
+}
+
+/**
+ * function:  replay_record_keyframe
+ * ---------------------------------
+ * appends a snapshot of the current game state and indexes it. Should be
+ * called at the start of a tick, before its input is handled.
+ *
+ * game:  the game being recorded
+ * tick:  the engine tick about to run
+ */
+void replay_record_keyframe(const struct game_ctx * game, uint64_t tick)
+{
+  size_t size;
+
+  if (!record_file)
+    return;
+
+  // grow the in-memory index (only happens every few keyframes)
+  if (record_index_count == record_index_capacity)
+  {
+    size_t     new_capacity = record_index_capacity ? record_index_capacity * 2 : 64;
+    uint64_t * new_index    = realloc(record_index, new_capacity * 2 * sizeof(uint64_t));
+
+    if (!new_index)
+      return;
+
+    record_index          = new_index;
+    record_index_capacity = new_capacity;
+  }
+
+  record_index[record_index_count * 2]     = tick;
+  record_index[record_index_count * 2 + 1] = ftell(record_file);
+  record_index_count++;
+
+  size = game_snapshot_save(game, record_snapshot);
+
+  fputc(REC_KEYFRAME, record_file);
+  varint_write(record_file, tick);
+  varint_write(record_file, size);
+  fwrite(record_snapshot, 1, size, record_file);
+
+  record_tick = tick;
+}
+
+/**
+ * function:  replay_record_close
+ * ------------------------------
+ * ends the input log, writes the keyframe index and closes the replay file.
+ *
+ * tick:  the tick the session ended on
+ */
+void replay_record_close(uint64_t tick)
+{
+  uint64_t index_offset;
+  size_t   i;
+
+  if (!record_file)
+    return;
+
+  fputc(REC_END, record_file);
+  varint_write(record_file, tick - record_tick);
+
+  index_offset = ftell(record_file);
+
+  for (i = 0; i < record_index_count * 2; i++)
+    u64_write(record_file, record_index[i]);
+
+  // trailer
+  u64_write(record_file, index_offset);
+  fputc(record_index_count         & 0xFF, record_file);
+  fputc((record_index_count >> 8)  & 0xFF, record_file);
+  fputc((record_index_count >> 16) & 0xFF, record_file);
+  fputc((record_index_count >> 24) & 0xFF, record_file);
+  fwrite(REPLAY_INDEX_MAGIC, 1, strlen(REPLAY_INDEX_MAGIC), record_file);
+
+  fclose(record_file);
+  free(record_snapshot);
+  free(record_index);
+
+  record_file = NULL;
+}
+
+
+/*
+ * playback functions
+ */
+
+/**
+ * function:  replay_play_open
+ * ---------------------------
+ * maps a replay file for playback.
+ *
+ * path:    replay file to read
+ * header:  filled with the recorded session information
+ *
+ * returns: true on success, false if the file can't be read or is invalid
+ */
+bool replay_play_open(const char * path, struct replay_header * header)
+{
+  struct stat st;
+  uint64_t    seed, x_bound, y_bound, keyframe_interval, turn_max_age;
+  size_t      magic_len = strlen(REPLAY_MAGIC);
+  void      * data;
+  int         fd;
+
+  if ((fd = open(path, O_RDONLY)) < 0)
+    return false;
+
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size <= magic_len)
+  {
+    close(fd);
+    return false;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (MAP_FAILED == data)
+    return false;
+
+  play_data = data;
+  play_size = st.st_size;
+  play_pos  = magic_len + 1;
+
+  if (0 != memcmp(play_data, REPLAY_MAGIC, magic_len)
+    || REPLAY_VERSION != play_data[magic_len]
+    || !varint_read(&seed)
+    || !varint_read(&x_bound)
+    || !varint_read(&y_bound)
+    || !varint_read(&keyframe_interval)
+    || !varint_read(&turn_max_age)
+    || 0 == keyframe_interval || keyframe_interval > UINT32_MAX
+    || 0 == turn_max_age || turn_max_age > UINT32_MAX
+    || !GAME_BOUNDS_VALID(x_bound, y_bound))
+  {
+    replay_play_close();
+    return false;
+  }
+
+  header->seed              = seed;
+  header->x_bound           = x_bound;
+  header->y_bound           = y_bound;
+  header->keyframe_interval = keyframe_interval;
+  header->turn_max_age      = turn_max_age;
+
+  // locate the keyframe index (missing if the recording was cut short)
+  play_index       = NULL;
+  play_index_count = 0;
+
+  if (play_size >= play_pos + TRAILER_SIZE
+    && 0 == memcmp(play_data + play_size - 4, REPLAY_INDEX_MAGIC, 4))
+  {
+    const unsigned char * trailer = play_data + play_size - TRAILER_SIZE;
+    uint64_t              index_offset = u64_read(trailer);
+    uint32_t              index_count  = trailer[8] | trailer[9] << 8
+      | trailer[10] << 16 | (uint32_t) trailer[11] << 24;
+
+    if (index_offset <= play_size - TRAILER_SIZE
+      && (play_size - TRAILER_SIZE - index_offset) / INDEX_ENTRY_SIZE == index_count)
+    {
+      play_index       = play_data + index_offset;
+      play_index_count = index_count;
+    }
+  }
+
+  play_base = 0;
+  play_advance();
+
+  return true;
+}
+
+/**
+ * function:  replay_play_input
+ * ----------------------------
+ * fetches the recorded keypress for a tick. Ticks must be requested in
+ * increasing order.
+ *
+ * tick:  the engine tick being played back
+ *
+ * returns: the key handled on this tick, or ERR if there was none
+ */
+int replay_play_input(uint64_t tick)
+{
+  int input_ch;
+
+  if (ERR == play_ch || tick != play_tick)
+    return ERR;
+
+  input_ch = play_ch;
+  play_advance();
+
+  return input_ch;
+}
+
+/**
+ * function:  replay_play_seek
+ * ---------------------------
+ * restores the game from the last keyframe at or before a tick, and
+ * continues playback from there. The caller then has to simulate the
+ * remaining (at most keyframe_interval) ticks up to the requested one.
+ *
+ * game:          the game to restore (set up on the replay's board)
+ * tick:          the tick to seek to
+ * keyframe_tick: filled with the tick of the restored keyframe
+ *
+ * returns: false if the replay has no usable keyframe index
+ */
+bool replay_play_seek(struct game_ctx * game, uint64_t tick,
+  uint64_t * keyframe_tick)
+{
+  uint32_t lo = 0,
+           hi = play_index_count;
+  uint64_t kf_tick, kf_size;
+
+  if (!play_index || 0 == play_index_count
+    || u64_read(play_index) > tick)
+    return false;
+
+  // find the last keyframe with a tick <= the requested one
+  while (hi - lo > 1)
+  {
+    uint32_t mid = lo + (hi - lo) / 2;
+
+    if (u64_read(play_index + (size_t) mid * INDEX_ENTRY_SIZE) <= tick)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  play_pos = u64_read(play_index + (size_t) lo * INDEX_ENTRY_SIZE + 8);
+
+  if (play_pos >= play_size || REC_KEYFRAME != play_data[play_pos++]
+    || !varint_read(&kf_tick)
+    || !varint_read(&kf_size)
+    || kf_size > play_size - play_pos
+    || !game_snapshot_load(game, play_data + play_pos, kf_size))
+    return false;
+
+  play_pos += kf_size;
+  play_base = kf_tick;
+  play_advance();
+
+  *keyframe_tick = kf_tick;
+
+  return true;
+}
+
+/**
+ * function:  replay_play_is_done
+ * ------------------------------
+ * returns: true once the given tick is past the end of the recording
+ */
+bool replay_play_is_done(uint64_t tick)
+{
+  return !play_data || (ERR == play_ch && tick >= play_tick);
+}
+
+/**
+ * function:  replay_play_close
+ * ----------------------------
+ * unmaps the replay being played back.
+ */
+void replay_play_close(void)
+{
+  if (play_data)
+    munmap((void *) play_data, play_size);
+
+  play_data = NULL;
+}
+
+/**
+ * function:  play_advance
+ * -----------------------
+ * reads up to the next input event into play_tick and play_ch, skipping
+ * keyframes. At the end of the log play_ch is ERR and play_tick is the
+ * final tick.
+ */
+static void play_advance(void)
+{
+  uint64_t delta, value;
+
+  while (play_pos < play_size)
+  {
+    switch (play_data[play_pos++])
+    {
+      case REC_INPUT:
+        if (!varint_read(&delta) || !varint_read(&value))
+          break;
+
+        play_base += delta;
+        play_tick  = play_base;
+        play_ch    = (int) value;
+        return;
+
+      case REC_KEYFRAME:
+        if (!varint_read(&play_base) || !varint_read(&value)
+          || value > play_size - play_pos)
+          break;
+
+        play_pos += value;
+        continue;
+
+      case REC_END:
+        if (varint_read(&delta))
+          play_base += delta;
+        break;
+    }
+
+    // end of log, or a corrupt record
+    break;
+  }
+
+  // end of log (possibly truncated, if the recording process was killed)
+  play_pos  = play_size;
+  play_tick = play_base;
+  play_ch   = ERR;
+}
+
+
+/*
+ * encoding functions
+ */
+
+/**
+ * function:  varint_write
+ * -----------------------
+ * writes an unsigned LEB128 varint (7 bits per byte, low bits first).
+ */
+static void varint_write(FILE * file, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    fputc((int) (value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+
+  fputc((int) value, file);
+}
+
+/**
+ * function:  varint_read
+ * ----------------------
+ * reads an unsigned LEB128 varint at the playback read position.
+ *
+ * returns: false if the file ended before the varint did
+ */
+static bool varint_read(uint64_t * value)
+{
+  unsigned int  shift = 0;
+  unsigned char byte;
+
+  *value = 0;
+
+  do
+  {
+    if (play_pos >= play_size || shift > 63)
+      return false;
+
+    byte    = play_data[play_pos++];
+    *value |= (uint64_t) (byte & 0x7F) << shift;
+    shift  += 7;
+  } while (byte & 0x80);
+
+  return true;
+}
+
+/**
+ * function:  u64_write
+ * --------------------
+ * writes a little-endian 64-bit integer.
+ */
+static void u64_write(FILE * file, uint64_t value)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    fputc((int) (value >> (8 * i)) & 0xFF, file);
+}
+
+/**
+ * function:  u64_read
+ * -------------------
+ * returns: the little-endian 64-bit integer at p
+ */
+static uint64_t u64_read(const unsigned char * p)
+{
+  uint64_t value = 0;
+  int      i;
+
+  for (i = 7; i >= 0; i--)
+    value = (value << 8) | p[i];
+
+  return value;
+}
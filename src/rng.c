@@ -0,0 +1,83 @@
+/**
+ * rng.c
+ *
+ * tty-snake pseudo-random number generator (xoshiro256**).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <rng.h>
+
+
+/**
+ * function:  rng_splitmix64
+ * -------------------------
+ * steps a splitmix64 generator, which turns any 64-bit state (even a small
+ * or sequential one) into well-mixed bits.
+ *
+ * state: the splitmix64 state
+ *
+ * returns: the next 64 bits
+ */
+uint64_t rng_splitmix64(uint64_t * state)
+{
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+  return z ^ (z >> 31);
+}
+
+/**
+ * function:  rng_seed
+ * -------------------
+ * seeds a generator. Every seed (including 0) gives a usable state, and
+ * nearby seeds give unrelated sequences.
+ *
+ * rng:   the generator
+ * seed:  the seed
+ */
+void rng_seed(struct rng * rng, uint64_t seed)
+{
+  unsigned int i;
+
+  for (i = 0; i < 4; i++)
+    rng->s[i] = rng_splitmix64(&seed);
+}
+
+/**
+ * function:  rng_jump
+ * -------------------
+ * advances a generator by 2^128 draws. Jumping a copy of a generator gives
+ * a second stream that won't overlap the first for 2^128 draws.
+ *
+ * rng: the generator
+ */
+void rng_jump(struct rng * rng)
+{
+  static const uint64_t jump[] = {
+    0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+    0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+  };
+
+  uint64_t     s[4] = { 0, 0, 0, 0 };
+  unsigned int i, b, j;
+
+  for (i = 0; i < 4; i++)
+  {
+    for (b = 0; b < 64; b++)
+    {
+      if (jump[i] & (1ull << b))
+      {
+        for (j = 0; j < 4; j++)
+          s[j] ^= rng->s[j];
+      }
+
+      rng_next(rng);
+    }
+  }
+
+  for (j = 0; j < 4; j++)
+    rng->s[j] = s[j];
+}
@@ -0,0 +1,235 @@
+/**
+ * screen.c
+ *
+ * tty-snake damage-tracked screen (shadow framebuffer).
+ *
+ * The graphics module composes every frame in full into frame_cells. Cells
+ * only count as damaged when they actually change, and screen_flush hands
+ * the renderer nothing but the cells that differ from shadow_cells, the
+ * last frame it emitted. An unchanged frame costs no output at all.
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <stdlib.h> // malloc(), free()
+
+#include <screen.h>
+
+// global variables
+static scell_t    * frame_cells  = NULL; // frame being composed
+static scell_t    * shadow_cells = NULL; // last frame emitted
+static bool       * dirty_rows   = NULL; // rows that changed since emitted
+static unsigned int width        = 0;
+static unsigned int height       = 0;
+
+
+/**
+ * function:  screen_setup
+ * -----------------------
+ * allocates a blank screen, all of which is emitted by the first flush.
+ *
+ * new_width:   number of columns
+ * new_height:  number of rows
+ *
+ * returns: true on success
+ */
+bool screen_setup(unsigned int new_width, unsigned int new_height)
+{
+  size_t n_cells = (size_t) new_width * new_height;
+
+  screen_unset();
+
+  frame_cells  = malloc(n_cells * sizeof(scell_t));
+  shadow_cells = malloc(n_cells * sizeof(scell_t));
+  dirty_rows   = malloc(new_height * sizeof(bool));
+
+  if ((n_cells && (!frame_cells || !shadow_cells))
+    || (new_height && !dirty_rows))
+  {
+    screen_unset();
+    return false;
+  }
+
+  width  = new_width;
+  height = new_height;
+
+  screen_fill(0, 0, width, height, ' ');
+  screen_invalidate();
+
+  return true;
+}
+
+/**
+ * function:  screen_resize
+ * ------------------------
+ * changes the screen's size. The new screen is blank and emitted in full by
+ * the next flush.
+ *
+ * new_width:   number of columns
+ * new_height:  number of rows
+ *
+ * returns: true on success
+ */
+bool screen_resize(unsigned int new_width, unsigned int new_height)
+{
+  return screen_setup(new_width, new_height);
+}
+
+/**
+ * function:  screen_invalidate
+ * ----------------------------
+ * forgets what was emitted, so that the next flush emits every cell (e.g.
+ * after the terminal was cleared).
+ */
+void screen_invalidate(void)
+{
+  size_t i;
+
+  for (i = 0; i < (size_t) width * height; i++)
+    shadow_cells[i] = SCELL_INVALID;
+
+  for (i = 0; i < height; i++)
+    dirty_rows[i] = true;
+}
+
+/**
+ * function:  screen_unset
+ * -----------------------
+ * frees the screen.
+ */
+void screen_unset(void)
+{
+  free(frame_cells);
+  free(shadow_cells);
+  free(dirty_rows);
+
+  frame_cells  = NULL;
+  shadow_cells = NULL;
+  dirty_rows   = NULL;
+  width        = 0;
+  height       = 0;
+}
+
+/**
+ * function:  screen_width
+ * -----------------------
+ * returns: the number of columns
+ */
+unsigned int screen_width(void)
+{
+  return width;
+}
+
+/**
+ * function:  screen_height
+ * ------------------------
+ * returns: the number of rows
+ */
+unsigned int screen_height(void)
+{
+  return height;
+}
+
+/**
+ * function:  screen_set
+ * ---------------------
+ * sets a cell of the frame being composed. Cells off the screen are ignored.
+ *
+ * x:     column of the cell
+ * y:     row of the cell
+ * cell:  the cell's contents
+ */
+void screen_set(unsigned int x, unsigned int y, scell_t cell)
+{
+  scell_t * p_cell;
+
+  if (x >= width || y >= height)
+    return;
+
+  p_cell = &frame_cells[(size_t) y * width + x];
+
+  if (*p_cell != cell)
+  {
+    *p_cell       = cell;
+    dirty_rows[y] = true;
+  }
+}
+
+/**
+ * function:  screen_fill
+ * ----------------------
+ * sets every cell of a rectangle of the frame being composed.
+ *
+ * x:           column of the rectangle's left edge
+ * y:           row of the rectangle's top edge
+ * fill_width:  width of the rectangle
+ * fill_height: height of the rectangle
+ * cell:        the cells' contents
+ */
+void screen_fill(unsigned int x, unsigned int y, unsigned int fill_width,
+  unsigned int fill_height, scell_t cell)
+{
+  unsigned int i, j;
+
+  for (j = y; j < y + fill_height; j++)
+    for (i = x; i < x + fill_width; i++)
+      screen_set(i, j, cell);
+}
+
+/**
+ * function:  screen_text
+ * ----------------------
+ * writes a line of text into the frame being composed (clipped to the
+ * screen).
+ *
+ * x:     column of the first character
+ * y:     row of the text
+ * text:  the text
+ * attr:  attributes of every character
+ */
+void screen_text(unsigned int x, unsigned int y, const char * text,
+  scell_t attr)
+{
+  for (; *text && x < width; text++, x++)
+    screen_set(x, y, (unsigned char) *text | attr);
+}
+
+/**
+ * function:  screen_flush
+ * -----------------------
+ * emits every cell of the composed frame that differs from the last frame
+ * emitted, and remembers the frame as emitted.
+ *
+ * emit:  called for every cell that changed
+ *
+ * returns: the number of cells emitted
+ */
+unsigned int screen_flush(screen_emit_fn emit)
+{
+  unsigned int n_emitted = 0,
+               x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    scell_t * frame_row  = &frame_cells[(size_t) y * width];
+    scell_t * shadow_row = &shadow_cells[(size_t) y * width];
+
+    if (!dirty_rows[y])
+      continue;
+
+    for (x = 0; x < width; x++)
+    {
+      if (frame_row[x] != shadow_row[x])
+      {
+        emit(x, y, frame_row[x]);
+
+        shadow_row[x] = frame_row[x];
+        n_emitted++;
+      }
+    }
+
+    dirty_rows[y] = false;
+  }
+
+  return n_emitted;
+}
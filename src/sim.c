@@ -0,0 +1,327 @@
+/**
+ * sim.c
+ *
+ * tty-snake headless simulation module (runs game logic without a terminal).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <ncurses.h>   // ERR, KEY_UP (key codes only, never initialized)
+#include <stdatomic.h> // atomic_bool
+#include <stdlib.h>    // abs()
+
+#include <engine.h>
+#include <game.h>
+
+#include <sim.h>
+
+// private forward declarations
+static int policy_autopilot(const struct game_ctx *);
+static int policy_random(struct rng *);
+static int policy_script(const char *, size_t, uint64_t);
+
+// global variables
+static atomic_bool is_sim_stopped; // set by sim_stop (e.g. on a signal)
+
+
+/**
+ * function:  sim_run
+ * ------------------
+ * runs games back to back in a tight loop, without sleeping, rendering or
+ * touching the terminal. Input for every tick comes from the configured
+ * policy and is passed through the engine's input handlers. Every game is
+ * played on the same game_ctx, restarted in place, so back-to-back games
+ * don't allocate. Stops early (with the results so far) on sim_stop.
+ *
+ * config:  simulation settings
+ * result:  filled with statistics about the simulation
+ */
+void sim_run(const struct sim_config * config, struct sim_result * result)
+{
+  nanosecond_t    start_ns = get_time_ns();
+  struct rng      seeds;
+  struct game_ctx game;
+
+  memset(result, 0, sizeof(struct sim_result));
+  rng_seed(&seeds, config->seed);
+
+  // the board size normally comes from the terminal (see graphics_setup);
+  // sim_play reseeds the game before every game
+  game_srand(&game, config->seed);
+  game_setup(&game, config->x_bound, config->y_bound,
+    config->x_bound / 2, config->y_bound / 2);
+
+  do
+  {
+    struct sim_game_result game_result;
+
+    // each game gets its own seed (drawn from the configured one)
+    sim_play(config, &game, rng_next(&seeds),
+      config->max_ticks ? config->max_ticks - result->ticks : 0,
+      &game_result);
+
+    result->games++;
+    result->ticks += game_result.ticks;
+
+    if (game_result.won)
+      result->wins++;
+
+    if (game_result.score > result->best_score)
+      result->best_score = game_result.score;
+  } while (result->ticks < config->max_ticks
+    && !atomic_load_explicit(&is_sim_stopped, memory_order_relaxed));
+
+  game_unset(&game);
+
+  result->elapsed_ns = get_time_ns() - start_ns;
+}
+
+/**
+ * function:  sim_play
+ * -------------------
+ * plays a single game until it ends (or runs out of ticks, or sim_stop is
+ * called). Only touches
+ * the game it is given, so any number of games can be played on different
+ * threads at the same time. A scripted game also stops after a pass of its
+ * script during which the snake never moved (e.g. one that never presses a
+ * key to start the game, or a direction): only keys change such a game, so
+ * every later pass would do the same.
+ *
+ * config:    simulation settings
+ * game:      game set up on the configured board, which is reseeded and
+ *              restarted (so that callers can reuse it for every game)
+ * seed:      seed for the game's randomizer (also seeds the input policy)
+ * max_ticks: stop the game after this many ticks (0 for no limit)
+ * result:    filled with statistics about the game
+ */
+void sim_play(const struct sim_config * config, struct game_ctx * game,
+  uint64_t seed, uint64_t max_ticks, struct sim_game_result * result)
+{
+  struct rng policy_rng;
+  size_t     script_len = config->script ? strlen(config->script) : 0;
+  bool       has_moved  = false;
+
+  memset(result, 0, sizeof(struct sim_game_result));
+
+  game_srand(game, seed);
+  game->turns.max_age = config->turn_max_age;
+
+  // the policy draws from its own stream, jumped clear of the game's
+  policy_rng = game->rng;
+  rng_jump(&policy_rng);
+  game_restart(game);
+
+  while (GS_ENDING != game->state
+    && (0 == max_ticks || result->ticks < max_ticks)
+    && !atomic_load_explicit(&is_sim_stopped, memory_order_relaxed))
+  {
+    engine_handle_input(game,
+      sim_policy_input(config, script_len, game, &policy_rng,
+        result->ticks));
+    game_update(game);
+
+    result->ticks++;
+
+    if (PU_NONE != game->snake.powerup)
+      result->powerup_ticks++;
+
+    has_moved |= (GS_RUNNING == game->state
+      && VEL_NONE != game->snake.velocity);
+
+    // an empty script presses nothing, so every tick is a pass of it
+    if (SIM_POLICY_SCRIPT == config->policy
+      && 0 == result->ticks % (script_len ? script_len : 1))
+    {
+      if (!has_moved)
+        break;
+
+      has_moved = false;
+    }
+  }
+
+  result->score  = game->score;
+  result->length = game->snake.length;
+  result->won    = game->won;
+}
+
+/**
+ * function:  sim_stop
+ * -------------------
+ * makes every running simulation stop after its current tick, as if its
+ * games had run out of ticks. Safe to call from a signal handler.
+ */
+void sim_stop(void)
+{
+  atomic_store_explicit(&is_sim_stopped, true, memory_order_relaxed);
+}
+
+/**
+ * function:  sim_policy_input
+ * ---------------------------
+ * generates the keypress for a simulated tick.
+ *
+ * config:      simulation settings (selects the policy)
+ * script_len:  length of config's script (measured once per game, not on
+ *                every tick)
+ * game:        the game being simulated
+ * rng:         randomizer for the random policy
+ * tick:        number of ticks the game has been simulated for
+ *
+ * returns: the key to press, or ERR if no key is pressed
+ */
+int sim_policy_input(const struct sim_config * config, size_t script_len,
+  const struct game_ctx * game, struct rng * rng, uint64_t tick)
+{
+  switch (config->policy)
+  {
+    case SIM_POLICY_RANDOM:
+      return policy_random(rng);
+
+    case SIM_POLICY_SCRIPT:
+      return policy_script(config->script, script_len, tick);
+
+    // SIM_POLICY_AUTOPILOT, other non-valid policies
+    default:
+      return policy_autopilot(game);
+  }
+}
+
+/**
+ * function:  sim_policy_from_string
+ * ---------------------------------
+ * name:  policy name ("autopilot", "random" or "script")
+ *
+ * returns: the named policy, or SIM_POLICY_COUNT if there is none
+ */
+enum sim_policy_t sim_policy_from_string(const char * name)
+{
+  enum sim_policy_t policy;
+
+  for (policy = 0; policy < SIM_POLICY_COUNT; policy++)
+    if (0 == strcmp(name, sim_policy_to_string(policy)))
+      break;
+
+  return policy;
+}
+
+/**
+ * function:  sim_policy_to_string
+ * -------------------------------
+ * returns: the policy's name, or NULL for SIM_POLICY_COUNT
+ */
+const char * sim_policy_to_string(enum sim_policy_t policy)
+{
+  const char * policy_names[SIM_POLICY_COUNT];
+
+  policy_names[SIM_POLICY_AUTOPILOT] = "autopilot";
+  policy_names[SIM_POLICY_RANDOM]    = "random";
+  policy_names[SIM_POLICY_SCRIPT]    = "script";
+
+  if (SIM_POLICY_COUNT <= policy)
+    return NULL;
+  else
+    return policy_names[policy];
+}
+
+
+/*
+ * input policies
+ */
+
+/**
+ * function:  policy_autopilot
+ * ---------------------------
+ * picks a direction that does not lead into a wall or the snake, preferring
+ * directions that bring the head closer to the food.
+ *
+ * game:  the game being simulated
+ *
+ * returns: the key for the chosen direction (a colliding one if the snake
+ *            is trapped, so that the game ends)
+ */
+static int policy_autopilot(const struct game_ctx * game)
+{
+  const struct ent_food  * food  = &game->food;
+  const struct ent_snake * snake = &game->snake;
+
+  const int dir_keys[4] = { KEY_UP, KEY_RIGHT, KEY_DOWN, KEY_LEFT };
+  const int dir_dx[4]   = {  0, 1, 0, -1 };
+  const int dir_dy[4]   = { -1, 0, 1,  0 };
+
+  unsigned int head_x = COORD_X(SNAKE_HEAD(snake)),
+               head_y = COORD_Y(SNAKE_HEAD(snake));
+
+  // the snake can't backtrack, so never pick the opposite direction
+  enum velocity_t cur_velocity = (VEL_NONE == snake->velocity)
+    ? snake->prev_velocity
+    : snake->velocity;
+
+  int best_key  = ERR,
+      best_dist = -1,
+      any_key   = ERR;
+  int i;
+
+  for (i = 0; i < 4; i++)
+  {
+    unsigned int next_x = head_x + dir_dx[i],
+                 next_y = head_y + dir_dy[i];
+    enum cell_t  next_cell = game_cell_at(game, next_x, next_y);
+    int          dist;
+
+    // direction i has velocity i + 1, its opposite is two directions over
+    if (VEL_NONE != cur_velocity && (i + 2) % 4 + 1 == (int) cur_velocity)
+      continue;
+
+    any_key = dir_keys[i];
+
+    if (CELL_EMPTY != next_cell && CELL_FOOD != next_cell)
+      continue;
+
+    dist = abs((int) food->x - (int) next_x) + abs((int) food->y - (int) next_y);
+
+    if (ERR == best_key || dist < best_dist)
+    {
+      best_key  = dir_keys[i];
+      best_dist = dist;
+    }
+  }
+
+  return (ERR != best_key) ? best_key : any_key;
+}
+
+/**
+ * function:  policy_random
+ * ------------------------
+ * rng:  the policy's own randomizer stream (jumped clear of the game's in
+ *         sim_play, so the keys don't depend on the game's draws)
+ *
+ * returns: a random direction key, or ERR (no key pressed)
+ */
+static int policy_random(struct rng * rng)
+{
+  const int keys[5] = { ERR, KEY_UP, KEY_RIGHT, KEY_DOWN, KEY_LEFT };
+
+  return keys[rng_bounded(rng, 5)];
+}
+
+/**
+ * function:  policy_script
+ * ------------------------
+ * script:      key script (SIM_SCRIPT_NOKEY for no input)
+ * script_len:  length of the script
+ * tick:        number of ticks the game has been simulated for
+ *
+ * returns: the script's key for this tick, or ERR (no key pressed)
+ */
+static int policy_script(const char * script, size_t script_len,
+  uint64_t tick)
+{
+  char script_ch;
+
+  if (0 == script_len)
+    return ERR;
+
+  script_ch = script[tick % script_len];
+
+  return (SIM_SCRIPT_NOKEY == script_ch) ? ERR : script_ch;
+}
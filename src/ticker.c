@@ -0,0 +1,133 @@
+/**
+ * ticker.c
+ *
+ * tty-snake fixed-timestep ticker (steps to absolute deadlines).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <ticker.h>
+
+
+/**
+ * function:  ticker_init
+ * ----------------------
+ * sets up a ticker whose first deadline is now.
+ *
+ * ticker:    the ticker
+ * rate:      deadlines per second
+ * catchup:   catch-up policy for missed deadlines
+ * max_steps: most steps to run at once when catching up
+ */
+void ticker_init(struct ticker * ticker, unsigned int rate,
+  enum ticker_catchup_t catchup, unsigned int max_steps)
+{
+  *ticker = (struct ticker) {
+    .rate      = rate,
+    .catchup   = catchup,
+    .max_steps = max_steps ? max_steps : 1
+  };
+
+  ticker_reset(ticker);
+}
+
+/**
+ * function:  ticker_reset
+ * -----------------------
+ * moves the ticker's next deadline to now, forgetting about deadlines that
+ * passed while nobody waited (e.g. while fast-forwarding a replay).
+ * Statistics are kept.
+ *
+ * ticker: the ticker
+ */
+void ticker_reset(struct ticker * ticker)
+{
+  ticker->origin_ns = ticker_now();
+  ticker->deadline  = 0;
+}
+
+/**
+ * function:  ticker_set_rate
+ * --------------------------
+ * changes the ticker's rate. The next deadline stays where it is, the ones
+ * after it are spaced at the new rate. Statistics are kept.
+ *
+ * ticker: the ticker
+ * rate:   deadlines per second
+ */
+void ticker_set_rate(struct ticker * ticker, unsigned int rate)
+{
+  if (rate == ticker->rate)
+    return;
+
+  ticker->origin_ns = ticker_deadline_ns(ticker);
+  ticker->deadline  = 0;
+  ticker->rate      = rate;
+}
+
+/**
+ * function:  ticker_advance
+ * -------------------------
+ * moves the ticker past every deadline that is due. It never sleeps:
+ * callers wait for ticker_deadline_ns themselves (e.g. on a timerfd).
+ *
+ * ticker: the ticker
+ *
+ * returns: the number of steps to run now (0 if no deadline is due yet)
+ */
+unsigned int ticker_advance(struct ticker * ticker)
+{
+  nanosecond_t now_ns = ticker_now();
+  uint64_t     due;
+  unsigned int steps;
+
+  if (now_ns < ticker_deadline_ns(ticker))
+    return 0;
+
+  // every deadline up to now is due
+  due = (now_ns - ticker->origin_ns) * ticker->rate / SECONDS + 1
+    - ticker->deadline;
+
+  ticker->deadline += due;
+  ticker->missed   += due - 1;
+
+  if (TICKER_CATCHUP_SIMULATE == ticker->catchup && due > ticker->max_steps)
+    steps = ticker->max_steps;
+  else if (TICKER_CATCHUP_SIMULATE == ticker->catchup)
+    steps = due;
+  else
+    steps = 1;
+
+  ticker->dropped += due - steps;
+  ticker->steps   += steps;
+
+  return steps;
+}
+
+/**
+ * function:  ticker_now
+ * ---------------------
+ * returns: the current time on the ticker's clock
+ */
+nanosecond_t ticker_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(TICKER_CLOCK_ID, &ts);
+
+  return (nanosecond_t) TIMESPEC2NS(ts);
+}
+
+/**
+ * function:  ticker_deadline_ns
+ * -----------------------------
+ * ticker: the ticker
+ *
+ * returns: the time of the ticker's next deadline (rounded up, so that it is
+ *            never reported as passed too early)
+ */
+nanosecond_t ticker_deadline_ns(const struct ticker * ticker)
+{
+  return ticker->origin_ns
+    + (ticker->deadline * SECONDS + ticker->rate - 1) / ticker->rate;
+}
@@ -0,0 +1,332 @@
+/**
+ * timerwheel.c
+ *
+ * tty-snake hashed timer wheel (timers counted in game updates).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <timerwheel.h>
+
+// slot of the timers due on a given tick
+#define TIMER_SLOT(tick) ((tick) & (TIMER_WHEEL_SLOTS - 1))
+
+// private forward declarations
+static bool timer_link(struct timer_wheel *, uint64_t, unsigned int, uint32_t,
+  unsigned int *);
+static void timer_unlink(struct timer_wheel *, unsigned int);
+static void timer_release(struct timer_wheel *, unsigned int);
+
+
+/**
+ * function:  timer_wheel_init
+ * ---------------------------
+ * sets up an empty, running wheel at tick 0.
+ *
+ * wheel: the wheel
+ * fire:  called for every timer that fires
+ * ctx:   passed to fire
+ */
+void timer_wheel_init(struct timer_wheel * wheel, timer_fire_fn fire,
+  void * ctx)
+{
+  unsigned int i;
+
+  wheel->now       = 0;
+  wheel->is_paused = false;
+  wheel->count     = 0;
+  wheel->free_head = 0;
+  wheel->fire      = fire;
+  wheel->ctx       = ctx;
+
+  for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    wheel->slots[i] = TIMER_WHEEL_NONE;
+
+  for (i = 0; i < TIMER_WHEEL_MAX; i++)
+  {
+    wheel->timers[i].state = TIMER_FREE;
+    wheel->timers[i].next  = (i + 1 < TIMER_WHEEL_MAX)
+      ? i + 1 : TIMER_WHEEL_NONE;
+  }
+}
+
+/**
+ * function:  timer_wheel_schedule
+ * -------------------------------
+ * schedules a timer to fire once the wheel advanced by the given number of
+ * ticks.
+ *
+ * wheel:   the wheel
+ * ticks:   ticks until the timer fires (0 fires on the next tick as well)
+ * kind:    what the timer does (see timer_fire_fn)
+ * arg:     argument for the fire function
+ * handle:  set to the timer's handle, for timer_wheel_cancel (may be NULL)
+ *
+ * returns: false if TIMER_WHEEL_MAX timers are already pending
+ */
+bool timer_wheel_schedule(struct timer_wheel * wheel, unsigned int ticks,
+  unsigned int kind, uint32_t arg, unsigned int * handle)
+{
+  return timer_link(wheel, wheel->now + (ticks ? ticks : 1), kind, arg,
+    handle);
+}
+
+/**
+ * function:  timer_wheel_cancel
+ * -----------------------------
+ * cancels a timer that hasn't fired yet (does nothing otherwise).
+ *
+ * wheel:   the wheel
+ * handle:  the timer's handle
+ */
+void timer_wheel_cancel(struct timer_wheel * wheel, unsigned int handle)
+{
+  if (handle >= TIMER_WHEEL_MAX)
+    return;
+
+  switch (wheel->timers[handle].state)
+  {
+    case TIMER_SCHEDULED:
+      timer_unlink(wheel, handle);
+      timer_release(wheel, handle);
+      break;
+
+    // already off its list, waiting for an earlier timer's fire function
+    case TIMER_DUE:
+      timer_release(wheel, handle);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * function:  timer_wheel_remaining
+ * --------------------------------
+ * wheel:   the wheel
+ * handle:  the timer's handle
+ *
+ * returns: the ticks left until the timer fires, or 0 if it isn't pending
+ */
+uint64_t timer_wheel_remaining(const struct timer_wheel * wheel,
+  unsigned int handle)
+{
+  if (handle >= TIMER_WHEEL_MAX
+    || TIMER_SCHEDULED != wheel->timers[handle].state)
+    return 0;
+
+  return wheel->timers[handle].deadline - wheel->now;
+}
+
+/**
+ * function:  timer_wheel_set_paused
+ * ---------------------------------
+ * pauses or resumes a wheel. A paused wheel ignores timer_wheel_advance, so
+ * its timers keep the ticks they had left.
+ *
+ * wheel:     the wheel
+ * is_paused: whether the wheel is paused
+ */
+void timer_wheel_set_paused(struct timer_wheel * wheel, bool is_paused)
+{
+  wheel->is_paused = is_paused;
+}
+
+/**
+ * function:  timer_wheel_advance
+ * ------------------------------
+ * advances a (running) wheel by a tick, firing the timers due on it in the
+ * order they sit in their slot. Only the tick's slot is looked at.
+ *
+ * wheel: the wheel
+ */
+void timer_wheel_advance(struct timer_wheel * wheel)
+{
+  uint16_t     due[TIMER_WHEEL_MAX];
+  unsigned int n_due = 0,
+               handle, i;
+
+  if (wheel->is_paused)
+    return;
+
+  wheel->now++;
+
+  // take the due timers off the slot first, so that fire functions can
+  // schedule and cancel timers freely
+  handle = wheel->slots[TIMER_SLOT(wheel->now)];
+
+  while (TIMER_WHEEL_NONE != handle)
+  {
+    struct timer_wheel_timer * timer = &wheel->timers[handle];
+    unsigned int               next  = timer->next;
+
+    if (timer->deadline == wheel->now)
+    {
+      timer_unlink(wheel, handle);
+      timer->state = TIMER_DUE;
+      due[n_due++] = handle;
+    }
+
+    handle = next;
+  }
+
+  for (i = 0; i < n_due; i++)
+  {
+    struct timer_wheel_timer * timer = &wheel->timers[due[i]];
+    unsigned int               kind  = timer->kind;
+    uint32_t                   arg   = timer->arg;
+
+    // cancelled by an earlier timer's fire function
+    if (TIMER_DUE != timer->state)
+      continue;
+
+    timer_release(wheel, due[i]);
+    wheel->fire(wheel->ctx, kind, arg);
+  }
+}
+
+/**
+ * function:  timer_wheel_save
+ * ---------------------------
+ * lists a wheel's pending timers, in an order timer_wheel_load restores
+ * exactly (including the order timers due on the same tick fire in).
+ *
+ * wheel:   the wheel
+ * entries: room for TIMER_WHEEL_MAX entries
+ *
+ * returns: the number of entries written
+ */
+unsigned int timer_wheel_save(const struct timer_wheel * wheel,
+  struct timer_wheel_entry * entries)
+{
+  unsigned int count = 0,
+               slot, handle;
+
+  for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+  {
+    for (handle = wheel->slots[slot]; TIMER_WHEEL_NONE != handle;
+      handle = wheel->timers[handle].next)
+    {
+      entries[count++] = (struct timer_wheel_entry) {
+        .deadline = wheel->timers[handle].deadline,
+        .kind     = wheel->timers[handle].kind,
+        .arg      = wheel->timers[handle].arg
+      };
+    }
+  }
+
+  return count;
+}
+
+/**
+ * function:  timer_wheel_load
+ * ---------------------------
+ * replaces a wheel's timers with the ones saved by timer_wheel_save. The
+ * wheel keeps its fire function and whether it is paused; timers get new
+ * handles.
+ *
+ * wheel:   the wheel
+ * now:     tick the wheel was at when it was saved
+ * entries: the saved timers
+ * count:   number of saved timers
+ *
+ * returns: false if the timers don't fit the wheel or are already overdue
+ */
+bool timer_wheel_load(struct timer_wheel * wheel, uint64_t now,
+  const struct timer_wheel_entry * entries, unsigned int count)
+{
+  bool is_paused = wheel->is_paused;
+
+  if (count > TIMER_WHEEL_MAX)
+    return false;
+
+  timer_wheel_init(wheel, wheel->fire, wheel->ctx);
+
+  wheel->now       = now;
+  wheel->is_paused = is_paused;
+
+  // timers are pushed at the front of their slot, so push them backwards
+  while (count-- > 0)
+  {
+    if (entries[count].deadline <= now
+      || !timer_link(wheel, entries[count].deadline, entries[count].kind,
+        entries[count].arg, NULL))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * function:  timer_link
+ * ---------------------
+ * takes a free timer and pushes it at the front of its deadline's slot.
+ *
+ * returns: false if no timer is free
+ */
+static bool timer_link(struct timer_wheel * wheel, uint64_t deadline,
+  unsigned int kind, uint32_t arg, unsigned int * handle)
+{
+  unsigned int               index = wheel->free_head;
+  struct timer_wheel_timer * timer;
+  uint16_t                 * slot;
+
+  if (TIMER_WHEEL_NONE == index)
+    return false;
+
+  timer = &wheel->timers[index];
+  slot  = &wheel->slots[TIMER_SLOT(deadline)];
+
+  wheel->free_head = timer->next;
+
+  timer->deadline = deadline;
+  timer->kind     = kind;
+  timer->arg      = arg;
+  timer->state    = TIMER_SCHEDULED;
+  timer->prev     = TIMER_WHEEL_NONE;
+  timer->next     = *slot;
+
+  if (TIMER_WHEEL_NONE != *slot)
+    wheel->timers[*slot].prev = index;
+
+  *slot = index;
+  wheel->count++;
+
+  if (handle)
+    *handle = index;
+
+  return true;
+}
+
+/**
+ * function:  timer_unlink
+ * -----------------------
+ * takes a scheduled timer off its slot's list.
+ */
+static void timer_unlink(struct timer_wheel * wheel, unsigned int handle)
+{
+  struct timer_wheel_timer * timer = &wheel->timers[handle];
+
+  if (TIMER_WHEEL_NONE != timer->prev)
+    wheel->timers[timer->prev].next = timer->next;
+  else
+    wheel->slots[TIMER_SLOT(timer->deadline)] = timer->next;
+
+  if (TIMER_WHEEL_NONE != timer->next)
+    wheel->timers[timer->next].prev = timer->prev;
+
+  wheel->count--;
+}
+
+/**
+ * function:  timer_release
+ * ------------------------
+ * returns a timer (no longer on any slot's list) to the free list.
+ */
+static void timer_release(struct timer_wheel * wheel, unsigned int handle)
+{
+  wheel->timers[handle].state = TIMER_FREE;
+  wheel->timers[handle].next  = wheel->free_head;
+  wheel->free_head            = handle;
+}
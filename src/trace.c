@@ -0,0 +1,237 @@
+/**
+ * trace.c
+ *
+ * tty-snake event tracing, exported as Chrome trace-event JSON (loads in
+ * Perfetto and chrome://tracing).
+ *
+ * See LICENSE for copyright information.
+ */
+
+#include <stdatomic.h> // atomic_fetch_add()
+#include <stdio.h>     // fopen(), fprintf()
+#include <stdlib.h>    // malloc(), free()
+#include <unistd.h>    // getpid()
+
+#include <trace.h>
+
+#define TRACE_INDEX(n) ((n) & (TRACE_RING_EVENTS - 1))
+
+// external global variables
+_Thread_local struct trace_ring * trace_thread_ring = NULL; // trace.h
+
+#ifdef USE_TRACE
+
+// global variables
+static struct trace_ring * rings[TRACE_MAX_THREADS];
+static atomic_uint         n_rings;
+static bool                is_tracing = false;
+static nanosecond_t        trace_start_ns; // events are shown relative to it
+
+// private forward declarations
+static void trace_write_event(FILE *, unsigned int, const struct trace_event *);
+
+
+/**
+ * function:  trace_setup
+ * ----------------------
+ * starts tracing. Threads are only traced once they call
+ * trace_thread_start, which must happen after this.
+ *
+ * returns: true on success
+ */
+bool trace_setup(void)
+{
+  atomic_init(&n_rings, 0);
+  trace_start_ns = get_time_ns();
+  is_tracing     = true;
+
+  return true;
+}
+
+/**
+ * function:  trace_thread_start
+ * -----------------------------
+ * allocates the calling thread's ring, so that its events are recorded from
+ * now on (does nothing if tracing is off, or too many threads are traced).
+ *
+ * thread_name: name the thread is shown with (must outlive the trace)
+ */
+void trace_thread_start(const char * thread_name)
+{
+  struct trace_ring * ring;
+  unsigned int        index;
+
+  if (!is_tracing || trace_thread_ring)
+    return;
+
+  index = atomic_fetch_add(&n_rings, 1);
+
+  if (index >= TRACE_MAX_THREADS || !(ring = malloc(sizeof(*ring))))
+    return;
+
+  ring->thread_name = thread_name;
+  ring->count       = 0;
+
+  rings[index]      = ring;
+  trace_thread_ring = ring;
+}
+
+/**
+ * function:  trace_record
+ * -----------------------
+ * records an event into the calling thread's ring, replacing its oldest
+ * event if it is full. Doesn't allocate. Use the TRACE_* macros rather than
+ * calling this directly.
+ *
+ * type:    type of the event
+ * name:    name of the event
+ * time_ns: when the event (or span) happened
+ * dur_ns:  duration of a TRACE_COMPLETE span
+ * detail:  optional detail (NULL if none)
+ * value:   optional value
+ */
+void trace_record(enum trace_event_t type, const char * name,
+  nanosecond_t time_ns, nanosecond_t dur_ns, const char * detail,
+  int64_t value)
+{
+  struct trace_ring  * ring  = trace_thread_ring;
+  struct trace_event * event = &ring->events[TRACE_INDEX(ring->count)];
+
+  event->time_ns = time_ns;
+  event->dur_ns  = dur_ns;
+  event->name    = name;
+  event->detail  = detail;
+  event->value   = value;
+  event->type    = type;
+
+  ring->count++;
+}
+
+/**
+ * function:  trace_write
+ * ----------------------
+ * writes every thread's events as Chrome trace-event JSON. Must only be
+ * called once the traced threads (other than the calling one) are done.
+ *
+ * path:  file to write the trace to
+ *
+ * returns: true on success
+ */
+bool trace_write(const char * path)
+{
+  FILE       * out = fopen(path, "w");
+  unsigned int n   = atomic_load(&n_rings),
+               i;
+  bool         is_first = true;
+
+  if (!out)
+    return false;
+
+  if (n > TRACE_MAX_THREADS)
+    n = TRACE_MAX_THREADS;
+
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+  for (i = 0; i < n; i++)
+  {
+    const struct trace_ring * ring = rings[i];
+    uint64_t                  first, j;
+    unsigned int              depth = 0;
+
+    if (!ring)
+      continue;
+
+    fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+      "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+      is_first ? "" : ",", (int) getpid(), i + 1, ring->thread_name);
+    is_first = false;
+
+    // only the latest events are left once the ring wrapped around
+    first = (ring->count > TRACE_RING_EVENTS)
+      ? ring->count - TRACE_RING_EVENTS : 0;
+
+    for (j = first; j < ring->count; j++)
+    {
+      const struct trace_event * event = &ring->events[TRACE_INDEX(j)];
+
+      // spans that began before the oldest event left can't be closed
+      if (TRACE_BEGIN == event->type)
+      {
+        depth++;
+      }
+      else if (TRACE_END == event->type)
+      {
+        if (0 == depth)
+          continue;
+
+        depth--;
+      }
+
+      fprintf(out, ",\n");
+      trace_write_event(out, i + 1, event);
+    }
+  }
+
+  fprintf(out, "\n]}\n");
+
+  return (0 == fclose(out));
+}
+
+/**
+ * function:  trace_unset
+ * ----------------------
+ * stops tracing and frees every thread's events. Must only be called once
+ * the traced threads (other than the calling one) are done.
+ */
+void trace_unset(void)
+{
+  unsigned int i;
+
+  for (i = 0; i < TRACE_MAX_THREADS; i++)
+  {
+    free(rings[i]);
+    rings[i] = NULL;
+  }
+
+  atomic_store(&n_rings, 0);
+  is_tracing        = false;
+  trace_thread_ring = NULL;
+}
+
+/**
+ * function:  trace_write_event
+ * ----------------------------
+ * writes a single event as a JSON object.
+ *
+ * out:   where to write it
+ * tid:   id of the thread it happened on
+ * event: the event
+ */
+static void trace_write_event(FILE * out, unsigned int tid,
+  const struct trace_event * event)
+{
+  // timestamps and durations are in microseconds
+  fprintf(out, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,"
+    "\"tid\":%u", event->name, (char) event->type,
+    (double) (int64_t) (event->time_ns - trace_start_ns) / 1000.0,
+    (int) getpid(),
+    tid);
+
+  if (TRACE_COMPLETE == event->type)
+    fprintf(out, ",\"dur\":%.3f", (double) event->dur_ns / 1000.0);
+
+  if (TRACE_INSTANT == event->type)
+  {
+    fprintf(out, ",\"s\":\"t\",\"args\":{\"value\":%lld",
+      (long long) event->value);
+
+    if (event->detail)
+      fprintf(out, ",\"detail\":\"%s\"", event->detail);
+
+    fprintf(out, "}");
+  }
+
+  fprintf(out, "}");
+}
+
+#endif // USE_TRACE
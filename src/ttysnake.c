@@ -11,8 +11,10 @@
 #include <stdlib.h> // on_exit()
 #include <stdio.h>  // printf()
 #include <time.h>   // time()
+#include <unistd.h> // getopt()
 
 #include <engine.h> // engine_start(), engine_stop()
+#include <sim.h>    // sim_run(), sim_stop()
 
 #ifdef DEBUG
 static void test_timespec_conversions(void)
@@ -51,6 +53,7 @@ static void test_timespec_conversions(void)
 void sig_handler(int signum)
 {
   engine_stop();
+  sim_stop();
 }
 
 void exit_handler(int ev, void * arg)
@@ -70,6 +73,68 @@ void setup_handlers(void)
   sigaction(SIGTERM, &action, NULL);
 }
 
+void usage(const char * prog_name)
+{
+  fprintf(stderr,
+    "usage: %s [-S seed] [-r file] [-C catchup] [-B backend] [-P file]\n"
+    "          [-T file] [-a age]\n"
+    "       %s -R file [-s tick] [-u] [-N] [-B backend] [-P file] [-T file]\n"
+    "       %s -H [-x width] [-y height] [-n ticks] [-p policy] [-i keys]\n"
+    "          [-a age]\n"
+    "\n"
+    "  -S seed    seed the randomizer (default: current time)\n"
+    "  -r file    record the session's input to a replay file\n"
+    "  -C catchup after a slow tick, 'drop' the missed ticks or 'simulate'\n"
+    "             them (default: simulate)\n"
+    "  -B backend draw with 'ncurses' or with raw 'ansi' escape sequences\n"
+    "             (default: ncurses)\n"
+    "  -P file    write the engine's phase timings to a file when it stops\n"
+    "             (default: stderr)\n"
+    "  -T file    write a trace of the engine (Chrome trace-event JSON, for\n"
+    "             Perfetto) to a file when it stops\n"
+    "  -a age     drop queued turns that waited more than this many ticks\n"
+    "             (default: %d)\n"
+    "  -R file    play back a replay file\n"
+    "  -s tick    start watching the replay at the given tick\n"
+    "  -u         play the replay back as fast as possible\n"
+    "  -N         play the replay back without a terminal\n"
+    "\n"
+    "  -H         run headless (no terminal, no rendering, no tick limit)\n"
+    "  -x width   headless board width  (default: %d)\n"
+    "  -y height  headless board height (default: %d)\n"
+    "  -n ticks   ticks to simulate, restarting finished games\n"
+    "             (default: 0, simulate a single game)\n"
+    "  -p policy  headless input policy: autopilot, random or script\n"
+    "  -i keys    key script for the script policy, one key per tick\n"
+    "             ('%c' presses nothing)\n",
+    prog_name, prog_name, prog_name, TURN_DEFAULT_MAX_AGE,
+    SIM_DEFAULT_X_BOUND, SIM_DEFAULT_Y_BOUND, SIM_SCRIPT_NOKEY
+  );
+}
+
+/**
+ * function:  run_headless
+ * -----------------------
+ * runs the headless simulator and prints its statistics.
+ *
+ * config:  simulation settings
+ */
+void run_headless(const struct sim_config * config)
+{
+  struct sim_result result;
+
+  sim_run(config, &result);
+
+  printf("board:      %ux%u\n", config->x_bound, config->y_bound);
+  printf("ticks:      %llu\n", (unsigned long long) result.ticks);
+  printf("games:      %llu\n", (unsigned long long) result.games);
+  printf("wins:       %llu\n", (unsigned long long) result.wins);
+  printf("best score: %u\n", result.best_score);
+  printf("elapsed:    %.3f ms\n", (double) result.elapsed_ns / MILLISECONDS);
+  printf("ticks/sec:  %.0f\n",
+    result.elapsed_ns ? (double) result.ticks * SECONDS / result.elapsed_ns : 0.0);
+}
+
 /**
  * function:  main
  * ---------------
@@ -82,6 +147,147 @@ void setup_handlers(void)
  */
 int main(int argc, char **argv)
 {
+  bool headless = false;
+  int  opt;
+
+  struct engine_config engine_config = {
+    .seed               = time(NULL),
+    .record_path        = NULL,
+    .replay_path        = NULL,
+    .replay_unthrottled = false,
+    .replay_headless    = false,
+    .replay_seek_tick   = 0,
+    .catchup            = TICKER_CATCHUP_SIMULATE,
+    .backend            = GRAPHICS_BACKEND_NCURSES,
+    .phase_stats_path   = NULL,
+    .trace_path         = NULL,
+    .turn_max_age       = TURN_DEFAULT_MAX_AGE
+  };
+
+  struct sim_config sim_config = {
+    .x_bound   = SIM_DEFAULT_X_BOUND,
+    .y_bound   = SIM_DEFAULT_Y_BOUND,
+    .max_ticks = 0,
+    .policy       = SIM_POLICY_AUTOPILOT,
+    .script       = NULL,
+    .turn_max_age = TURN_DEFAULT_MAX_AGE
+  };
+
+  while ((opt = getopt(argc, argv, "S:r:C:B:P:T:a:R:s:uNHx:y:n:p:i:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'S':
+        engine_config.seed = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'r':
+        engine_config.record_path = optarg;
+        break;
+
+      case 'C':
+        if (0 == strcmp(optarg, "drop"))
+          engine_config.catchup = TICKER_CATCHUP_DROP;
+        else if (0 == strcmp(optarg, "simulate"))
+          engine_config.catchup = TICKER_CATCHUP_SIMULATE;
+        else
+        {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'B':
+        engine_config.backend = graphics_backend_from_string(optarg);
+
+        if (GRAPHICS_BACKEND_COUNT == engine_config.backend)
+        {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'P':
+        engine_config.phase_stats_path = optarg;
+        break;
+
+      case 'T':
+        engine_config.trace_path = optarg;
+        break;
+
+      case 'a':
+        engine_config.turn_max_age = strtoul(optarg, NULL, 10);
+        sim_config.turn_max_age    = engine_config.turn_max_age;
+        break;
+
+      case 'R':
+        engine_config.replay_path = optarg;
+        break;
+
+      case 's':
+        engine_config.replay_seek_tick = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'u':
+        engine_config.replay_unthrottled = true;
+        break;
+
+      case 'N':
+        engine_config.replay_headless    = true;
+        engine_config.replay_unthrottled = true;
+        break;
+
+      case 'H':
+        headless = true;
+        break;
+
+      case 'x':
+        sim_config.x_bound = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'y':
+        sim_config.y_bound = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'n':
+        sim_config.max_ticks = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'p':
+        sim_config.policy = sim_policy_from_string(optarg);
+
+        if (SIM_POLICY_COUNT == sim_config.policy)
+        {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'i':
+        sim_config.script = optarg;
+        break;
+
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  // boards the game can't be set up on (see GAME_BOUNDS_VALID)
+  if (!GAME_BOUNDS_VALID(sim_config.x_bound, sim_config.y_bound))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // a turn has always waited at least one update when it is applied, so 0
+  // would drop every turn
+  if (0 == engine_config.turn_max_age)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
   // configure interrupt handlers
   setup_handlers();
 
@@ -90,8 +296,14 @@ int main(int argc, char **argv)
   test_timespec_conversions();
 #endif // DEBUG
 
-  // seed the randomizer
-  srand(time(NULL));
+  // headless games draw their seeds from the given one (replays use the
+  // recorded seed instead)
+  sim_config.seed = engine_config.seed;
+
+  if (headless)
+    run_headless(&sim_config);
+  else
+    engine_start(&engine_config);
 
-  engine_start();
+  return 0;
 }